@@ -0,0 +1,103 @@
+#include "archive.h"
+#include <chrono>
+#include <vector>
+
+Archive::Archive(const ArchiveOptions& options) : options_(options), ring_(options.capacity) {} // Constructor
+
+Archive::~Archive()
+{
+    stop();
+}
+
+void Archive::setSink(ArchiveSink sink) { sink_ = std::move(sink); }
+
+void Archive::setIdle(ArchiveIdle idle) { idle_ = std::move(idle); }
+
+void Archive::start()
+{
+    if (consumer_.joinable()) return;
+    stopping_ = false;
+    consumer_ = std::thread(&Archive::consumeLoop, this);
+}
+
+void Archive::stop()
+{
+    if (!consumer_.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stopping_ = true;
+    }
+    wake_cv_.notify_one();
+    space_cv_.notify_all();
+    consumer_.join();
+}
+
+bool Archive::push(const SharedMessage& message)
+{
+    while (!ring_.tryPush(message))
+    {
+        if (options_.overflow == ArchiveOverflow::DropNewest || stopping_ || !consumer_.joinable())
+        {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        std::unique_lock<std::mutex> lock(wake_mutex_); // Block: rare slow path
+        wake_cv_.notify_one();
+        space_cv_.wait(lock, [this]()
+        {
+            return stopping_.load() || ring_.size() < ring_.capacity();
+        });
+    }
+
+    enqueued_.fetch_add(1, std::memory_order_relaxed);
+
+    std::atomic_thread_fence(std::memory_order_seq_cst); // Pairs with the consumer's fence before it sleeps
+    if (sleeping_.load(std::memory_order_relaxed))
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        wake_cv_.notify_one();
+    }
+    return true;
+}
+
+ArchiveStats Archive::stats() const
+{
+    return ArchiveStats{enqueued_.load(std::memory_order_relaxed), archived_.load(std::memory_order_relaxed),
+                        dropped_.load(std::memory_order_relaxed), batches_.load(std::memory_order_relaxed),
+                        ring_.size(), ring_.capacity()};
+}
+
+void Archive::consumeLoop()
+{
+    std::vector<SharedMessage> batch(options_.batch < 1 ? 1 : options_.batch);
+
+    while (true)
+    {
+        size_t count = ring_.popBatch(batch.data(), batch.size());
+        if (count > 0)
+        {
+            if (options_.overflow == ArchiveOverflow::Block)
+            {
+                { std::lock_guard<std::mutex> lock(wake_mutex_); } // A producer between its check and its wait is woken too
+                space_cv_.notify_all();
+            }
+            if (sink_) sink_(batch.data(), count);
+            for (size_t i = 0; i < count; ++i) batch[i] = SharedMessage(); // Release the references
+            archived_.fetch_add(count, std::memory_order_relaxed);
+            batches_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        int idleMs = idle_ ? idle_() : -1; // Outside the lock, like the sink
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        if (stopping_) break; // Ring is empty and producers are gone
+
+        sleeping_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst); // A push after this fence sees sleeping_
+        auto ready = [this]() { return stopping_.load() || ring_.size() > 0; };
+        if (idleMs < 0) wake_cv_.wait(lock, ready);
+        else wake_cv_.wait_for(lock, std::chrono::milliseconds(idleMs), ready);
+        sleeping_.store(false, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "message_buffer.h"
+#include "mpsc_ring.h"
+
+// Archive stage behind Server::addMessageToQueue(). Handler threads and event loops push
+// message references into a bounded lock-free multi-producer/single-consumer ring; one
+// consumer thread drains it in batches and hands every batch to the archive sink.
+
+enum class ArchiveOverflow
+{
+    DropNewest, // Count the message as dropped and move on (never stalls a producer)
+    Block       // Wait for the consumer to make room
+};
+
+struct ArchiveOptions
+{
+    size_t capacity = 65536; // Ring slots, rounded up to a power of two
+    size_t batch = 256; // Messages handed to the sink per call at most
+    ArchiveOverflow overflow = ArchiveOverflow::DropNewest; // What a producer does when the ring is full
+};
+
+struct ArchiveStats
+{
+    uint64_t enqueued; // Messages accepted into the ring
+    uint64_t archived; // Messages handed to the sink
+    uint64_t dropped; // Messages refused because the ring was full
+    uint64_t batches; // Sink calls
+    size_t pending; // Messages in the ring right now
+    size_t capacity; // Ring slots
+};
+
+// Receives each drained batch on the consumer thread. The array is only valid during the call.
+using ArchiveSink = std::function<void(const SharedMessage* batch, size_t count)>;
+
+// Runs on the consumer thread whenever the ring is empty, for work the sink deferred (a log
+// sync that is not due yet). Returns ms until it wants to run again, -1 to sleep until a push.
+using ArchiveIdle = std::function<int()>;
+
+class Archive {
+public:
+    explicit Archive(const ArchiveOptions& options = ArchiveOptions()); // Constructor
+    ~Archive(); // Destructor, stops the consumer
+
+    void setSink(ArchiveSink sink); // Call before start()
+    void setIdle(ArchiveIdle idle); // Call before start()
+    void start(); // Launch the consumer thread
+    void stop(); // Drain what is left and join the consumer
+
+    bool push(const SharedMessage& message); // Lock-free unless the Block policy has to wait. False if dropped
+    ArchiveStats stats() const; // Counters, safe from any thread
+
+private:
+    void consumeLoop(); // Consumer thread: pop batches, hand them to the sink, sleep when empty
+
+    ArchiveOptions options_;
+    MpscRing ring_;
+    ArchiveSink sink_;
+    ArchiveIdle idle_;
+
+    std::atomic<uint64_t> enqueued_{0};
+    std::atomic<uint64_t> archived_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> batches_{0};
+
+    std::thread consumer_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<bool> sleeping_{false}; // Consumer is (about to be) waiting on wake_cv_
+    std::mutex wake_mutex_; // Only taken to sleep or to wake a sleeping consumer
+    std::condition_variable wake_cv_;
+    std::condition_variable space_cv_; // Block policy: producers wait here for free slots
+};
@@ -0,0 +1,624 @@
+#include "frame.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+// Fan-out throughput and end-to-end latency of main_server under K simulated clients.
+// Clients are split into rooms of each requested size; one member per room sends, and
+// every other member timestamps what it receives against the send time in the payload.
+// Usage: chat_bench [--port=N] [--server=PATH | --pid=N] [--clients=K] [--threads=T]
+//                   [--room-sizes=A,B,..] [--message-sizes=A,B,..] [--messages=N] [--window=N]
+//                   [--modes=threaded,epoll,uring] [--mixed=H] [--flood-size=BYTES] [-- server options...]
+// Without --pid the server binary (default ./main_server) is started on --port, with the
+// options after "--", and stopped at the end. Every case prints one RESULT line. With
+// --modes the whole run is repeated against a fresh server per --mode and a table compares
+// msgs/s and p99 of every case across the modes. --mixed=H adds H heavy senders that keep
+// their sockets full of --flood-size frames into a room of their own for the whole run, so
+// the cases measure what quiet users see next to a flood (use --window=1 for single messages).
+
+using Clock = std::chrono::steady_clock;
+
+const uint32_t WARMUP_SEQ = UINT32_MAX; // Marks frames sent until every room member has joined
+const size_t BENCH_HEADER = 16; // [u64 send time ns][u32 sequence][u32 room], start of every text
+
+struct Settings
+{
+    int port = 9900;
+    std::string server = "./main_server";
+    pid_t pid = -1; // Existing server to sample, no server is started when set
+    std::vector<std::string> serverArgs;
+    int clients = 1000;
+    int threads = 2;
+    std::vector<int> roomSizes = {10, 100, 1000};
+    std::vector<int> messageSizes = {64, 1024};
+    uint64_t messages = 10000; // Per case, spread over the rooms
+    uint64_t window = 64; // Messages a sender may have ahead of its room's last member
+    double timeout = 30.0; // Seconds before a case gives up waiting for deliveries
+    std::vector<std::string> modes; // Server --mode values to compare, empty runs the server as configured
+    int flooders = 0; // Mixed load: heavy senders running alongside every case
+    size_t floodSize = 4096; // Text bytes per flood frame
+};
+
+struct CaseResult // One line of the --modes comparison
+{
+    int roomSize;
+    int messageSize;
+    double msgsPerSec;
+    double p99;
+};
+
+class LatencyHistogram // Log-linear buckets, 32 per power of two: about 3% error, fixed memory
+{
+public:
+    void record(uint64_t ns)
+    {
+        ++buckets_[index(ns)];
+        ++count_;
+    }
+
+    void merge(const LatencyHistogram& other)
+    {
+        for (size_t i = 0; i < buckets_.size(); ++i) buckets_[i] += other.buckets_[i];
+        count_ += other.count_;
+    }
+
+    uint64_t percentile(double p) const // Upper bound of the bucket holding the p-th sample
+    {
+        uint64_t rank = static_cast<uint64_t>(p / 100.0 * count_);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < buckets_.size(); ++i)
+        {
+            seen += buckets_[i];
+            if (seen > rank) return upper(i);
+        }
+        return 0;
+    }
+
+    uint64_t count() const { return count_; }
+
+private:
+    static constexpr int SUB_BITS = 5;
+    static constexpr uint64_t SUB = 1 << SUB_BITS;
+
+    static size_t index(uint64_t v)
+    {
+        if (v < SUB) return v;
+        int e = 63 - __builtin_clzll(v);
+        return (e - SUB_BITS + 1) * SUB + ((v >> (e - SUB_BITS)) & (SUB - 1));
+    }
+
+    static uint64_t upper(size_t i)
+    {
+        if (i < SUB) return i;
+        int e = static_cast<int>(i / SUB) + SUB_BITS - 1;
+        uint64_t width = uint64_t(1) << (e - SUB_BITS);
+        return ((SUB + i % SUB) << (e - SUB_BITS)) + width - 1;
+    }
+
+    std::array<uint64_t, 64 * SUB> buckets_{};
+    uint64_t count_ = 0;
+};
+
+struct Room
+{
+    std::string name; // Unique per case, so late frames of an earlier case are ignored
+    uint32_t index = 0; // Position in the case's room list
+    int members = 0;
+    uint64_t quota = 0; // Messages the sender sends in this case
+    uint64_t sent = 0; // Owner thread of the sender only
+    Clock::time_point lastWarmup;
+    std::atomic<uint64_t> acked{0}; // Highest sequence + 1 seen by the last member
+    std::atomic<int> warmed{0}; // Members that have seen a warmup frame
+};
+
+struct BenchClient
+{
+    int fd = -1;
+    FrameDecoder decoder;
+    std::string out; // Bytes accepted but not yet written (non-blocking socket)
+    size_t outPos = 0;
+    Room* room = nullptr; // Room of the current case, null when idle
+    bool sender = false;
+    bool probe = false; // Last member: its progress paces the sender
+    bool warmed = false;
+};
+
+enum class Phase { Warmup, Run, Done };
+
+struct Case // Shared between the orchestrating thread and the workers
+{
+    std::atomic<Phase> phase{Phase::Warmup};
+    std::atomic<uint64_t> delivered{0};
+    size_t messageSize = 0;
+    uint64_t window = 0;
+};
+
+uint64_t nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+bool flushOut(BenchClient& c) // false on a socket error
+{
+    while (c.outPos < c.out.size())
+    {
+        ssize_t n = send(c.fd, c.out.data() + c.outPos, c.out.size() - c.outPos, MSG_NOSIGNAL);
+        if (n > 0) { c.outPos += n; continue; }
+        if (n == -1 && errno == EINTR) continue;
+        return n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+    c.out.clear();
+    c.outPos = 0;
+    return true;
+}
+
+void queueBenchFrame(BenchClient& c, uint32_t seq, uint32_t roomIndex, size_t messageSize)
+{
+    std::string text(std::max(messageSize, BENCH_HEADER), 'x');
+    uint64_t ts = nowNs();
+    std::memcpy(&text[0], &ts, 8);
+    std::memcpy(&text[8], &seq, 4);
+    std::memcpy(&text[12], &roomIndex, 4);
+    c.out += encodeRoomFrame(c.room->name, text);
+}
+
+bool sendBlocking(BenchClient& c, const std::string& frame) // Control frames outside the worker loop
+{
+    c.out += frame;
+    for (int tries = 0; tries < 1000; ++tries)
+    {
+        if (!flushOut(c)) return false;
+        if (c.out.empty()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+void worker(std::vector<BenchClient*> mine, Case& run, LatencyHistogram& hist)
+{
+    int ep = epoll_create1(0);
+    std::vector<BenchClient*> senders;
+    for (BenchClient* c : mine)
+    {
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = c;
+        epoll_ctl(ep, EPOLL_CTL_ADD, c->fd, &ev);
+        if (c->sender) senders.push_back(c);
+    }
+
+    epoll_event events[256];
+    while (run.phase.load(std::memory_order_acquire) != Phase::Done)
+    {
+        Phase phase = run.phase.load(std::memory_order_acquire);
+        bool more = false; // A sender could send right away
+        for (BenchClient* c : senders)
+        {
+            if (!flushOut(*c) || !c->out.empty()) continue;
+            Room& room = *c->room;
+            if (phase == Phase::Warmup)
+            {
+                if (room.warmed.load(std::memory_order_relaxed) < room.members - 1 &&
+                    Clock::now() - room.lastWarmup > std::chrono::milliseconds(20))
+                {
+                    queueBenchFrame(*c, WARMUP_SEQ, room.index, run.messageSize);
+                    room.lastWarmup = Clock::now();
+                }
+            }
+            else
+            {
+                for (int burst = 0; burst < 16 && room.sent < room.quota &&
+                     room.sent - room.acked.load(std::memory_order_acquire) < run.window; ++burst)
+                {
+                    queueBenchFrame(*c, static_cast<uint32_t>(room.sent++), room.index, run.messageSize);
+                }
+                more = more || (room.sent < room.quota && room.sent - room.acked.load(std::memory_order_relaxed) < run.window);
+            }
+            flushOut(*c);
+        }
+
+        int n = epoll_wait(ep, events, 256, more ? 0 : 1);
+        for (int i = 0; i < n; ++i)
+        {
+            BenchClient* c = static_cast<BenchClient*>(events[i].data.ptr);
+            uint64_t delivered = 0;
+            while (true)
+            {
+                char* buf = c->decoder.writePtr();
+                ssize_t got = recv(c->fd, buf, c->decoder.writable(), 0);
+                if (got <= 0) break;
+                c->decoder.commit(got);
+                uint64_t now = nowNs();
+
+                FrameView frame;
+                while (c->decoder.next(frame) == FrameDecoder::Status::Frame)
+                {
+                    std::string_view roomName, text;
+                    if (frame.type != FrameType::RoomChat || !parseRoomPayload(frame.payload, roomName, text)) continue;
+                    if (c->room == nullptr || roomName != c->room->name || text.size() < BENCH_HEADER) continue;
+
+                    uint64_t ts;
+                    uint32_t seq;
+                    std::memcpy(&ts, text.data(), 8);
+                    std::memcpy(&seq, text.data() + 8, 4);
+                    if (seq == WARMUP_SEQ)
+                    {
+                        if (!c->warmed) { c->warmed = true; c->room->warmed.fetch_add(1, std::memory_order_relaxed); }
+                        continue;
+                    }
+                    hist.record(now - ts);
+                    ++delivered;
+                    if (c->probe) c->room->acked.store(uint64_t(seq) + 1, std::memory_order_release);
+                }
+            }
+            if (delivered) run.delivered.fetch_add(delivered, std::memory_order_relaxed);
+        }
+    }
+    close(ep);
+}
+
+void flood(std::vector<int> fds, size_t frameSize, std::atomic<bool>& running, std::atomic<uint64_t>& sentBytes)
+{
+    // Every flooder is a member of the flood room, so each frame also fans out to the others.
+    // They drain what they receive, the server never sees them as slow consumers.
+    std::string frame = encodeRoomFrame("flood", std::string(frameSize, 'f'));
+    std::string burst;
+    while (burst.size() < 256 * 1024) burst += frame; // Whole frames, so wrapping around keeps the framing
+    std::vector<size_t> offsets(fds.size(), 0);
+    std::vector<char> sink(64 * 1024);
+
+    while (running.load(std::memory_order_relaxed))
+    {
+        bool progress = false;
+        for (size_t i = 0; i < fds.size(); ++i)
+        {
+            ssize_t n = send(fds[i], burst.data() + offsets[i], burst.size() - offsets[i], MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (n > 0)
+            {
+                offsets[i] = (offsets[i] + n) % burst.size();
+                sentBytes.fetch_add(n, std::memory_order_relaxed);
+                progress = true;
+            }
+            while (recv(fds[i], sink.data(), sink.size(), MSG_DONTWAIT) > 0) progress = true;
+        }
+        if (!progress) std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+long readStatusKb(pid_t pid, const char* field) // VmRSS / VmHWM of the server, -1 if unknown
+{
+    std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+    std::string line;
+    size_t len = std::strlen(field);
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, len, field) == 0) return std::stol(line.substr(len + 1));
+    }
+    return -1;
+}
+
+int connectLocal(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+std::vector<std::string> parseNames(const std::string& value)
+{
+    std::vector<std::string> out;
+    size_t pos = 0;
+    while (pos <= value.size())
+    {
+        size_t comma = value.find(',', pos);
+        if (comma == std::string::npos) comma = value.size();
+        out.push_back(value.substr(pos, comma - pos));
+        pos = comma + 1;
+    }
+    return out;
+}
+
+std::vector<int> parseList(const std::string& value)
+{
+    std::vector<int> out;
+    size_t pos = 0;
+    while (pos <= value.size())
+    {
+        size_t comma = value.find(',', pos);
+        if (comma == std::string::npos) comma = value.size();
+        out.push_back(std::stoi(value.substr(pos, comma - pos)));
+        pos = comma + 1;
+    }
+    return out;
+}
+
+bool parseArgs(int argc, char* argv[], Settings& s)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--")
+        {
+            for (++i; i < argc; ++i) s.serverArgs.push_back(argv[i]);
+            break;
+        }
+        size_t eq = arg.find('=');
+        if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) return false;
+        std::string key = arg.substr(2, eq - 2);
+        std::string value = arg.substr(eq + 1);
+        try
+        {
+            if (key == "port") s.port = std::stoi(value);
+            else if (key == "server") s.server = value;
+            else if (key == "pid") s.pid = std::stoi(value);
+            else if (key == "clients") s.clients = std::stoi(value);
+            else if (key == "threads") s.threads = std::stoi(value);
+            else if (key == "room-sizes") s.roomSizes = parseList(value);
+            else if (key == "message-sizes") s.messageSizes = parseList(value);
+            else if (key == "messages") s.messages = std::stoull(value);
+            else if (key == "window") s.window = std::stoull(value);
+            else if (key == "timeout") s.timeout = std::stod(value);
+            else if (key == "modes") s.modes = parseNames(value);
+            else if (key == "mixed") s.flooders = std::stoi(value);
+            else if (key == "flood-size") s.floodSize = std::stoul(value);
+            else return false;
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+    }
+    return s.clients > 1 && s.threads > 0 && s.window > 0 && s.flooders >= 0 && s.floodSize >= 1 &&
+           s.floodSize <= MAX_FRAME_PAYLOAD - 256 && (s.modes.empty() || s.pid == -1); // A running server can't switch modes
+}
+
+pid_t startServer(const Settings& s)
+{
+    pid_t pid = fork();
+    if (pid != 0) return pid;
+
+    int devnull = open("/dev/null", O_WRONLY);
+    dup2(devnull, STDOUT_FILENO); // The server logs every connection
+    std::vector<std::string> args = {s.server, std::to_string(s.port)};
+    args.insert(args.end(), s.serverArgs.begin(), s.serverArgs.end());
+    std::vector<char*> argv;
+    for (std::string& a : args) argv.push_back(&a[0]);
+    argv.push_back(nullptr);
+    execv(s.server.c_str(), argv.data());
+    std::cerr << "✗ Can't start " << s.server << ": " << strerror(errno) << std::endl;
+    _exit(127);
+}
+
+int runSuite(Settings s, const std::string& mode, std::vector<CaseResult>& results) // Every case against one server
+{
+    if (!mode.empty()) s.serverArgs.push_back("--mode=" + mode);
+    bool owned = s.pid == -1;
+    if (owned) s.pid = startServer(s);
+
+    std::vector<std::unique_ptr<BenchClient>> clients;
+    for (int attempt = 0; attempt < 100 && clients.empty(); ++attempt) // Wait for the server to listen
+    {
+        int fd = connectLocal(s.port);
+        if (fd == -1) { std::this_thread::sleep_for(std::chrono::milliseconds(50)); continue; }
+        clients.push_back(std::make_unique<BenchClient>());
+        clients.back()->fd = fd;
+    }
+    while (!clients.empty() && static_cast<int>(clients.size()) < s.clients)
+    {
+        int fd = connectLocal(s.port);
+        if (fd == -1) break;
+        clients.push_back(std::make_unique<BenchClient>());
+        clients.back()->fd = fd;
+    }
+    std::vector<int> flooders;
+    for (int i = 0; !clients.empty() && i < s.flooders; ++i)
+    {
+        BenchClient heavy;
+        heavy.fd = connectLocal(s.port);
+        if (heavy.fd == -1 || !sendBlocking(heavy, encodeFrame(FrameType::Join, "flood"))) break;
+        flooders.push_back(heavy.fd);
+    }
+    if (static_cast<int>(clients.size()) < s.clients || static_cast<int>(flooders.size()) < s.flooders)
+    {
+        std::cerr << "✗ Connected " << clients.size() << " of " << s.clients << " clients and " << flooders.size()
+                  << " of " << s.flooders << " heavy senders on port " << s.port << std::endl;
+        for (int fd : flooders) close(fd);
+        if (owned) { kill(s.pid, SIGTERM); waitpid(s.pid, nullptr, 0); }
+        return 1;
+    }
+
+    std::atomic<bool> flooding{true};
+    std::atomic<uint64_t> floodBytes{0};
+    std::thread floodThread;
+    if (!flooders.empty()) floodThread = std::thread(flood, flooders, s.floodSize, std::ref(flooding), std::ref(floodBytes));
+
+    std::cout << "=== Chat Benchmark (" << s.clients << " clients, " << s.threads << " threads, "
+              << s.messages << " messages per case" << (mode.empty() ? "" : ", --mode=" + mode)
+              << (s.flooders == 0 ? "" : ", " + std::to_string(s.flooders) + " heavy senders") << ") ===" << std::endl;
+    std::cout << std::left << std::setw(8) << "room" << std::setw(8) << "bytes" << std::setw(12) << "msgs/s"
+              << std::setw(14) << "deliveries/s" << std::setw(10) << "p50 us" << std::setw(10) << "p99 us"
+              << std::setw(10) << "p999 us" << std::setw(10) << "lost" << "server RSS kB" << std::endl;
+
+    int caseId = 0;
+    for (int roomSize : s.roomSizes)
+    {
+        for (int messageSize : s.messageSizes)
+        {
+            ++caseId;
+            if (roomSize < 2 || roomSize > s.clients) continue;
+
+            int roomCount = s.clients / roomSize;
+            std::vector<std::unique_ptr<Room>> rooms;
+            for (int r = 0; r < roomCount; ++r)
+            {
+                rooms.push_back(std::make_unique<Room>());
+                rooms.back()->name = "bench-" + std::to_string(caseId) + "-" + std::to_string(r);
+                rooms.back()->index = r;
+                rooms.back()->members = roomSize;
+                rooms.back()->quota = s.messages / roomCount + (uint64_t(r) < s.messages % roomCount ? 1 : 0);
+            }
+
+            for (int i = 0; i < roomCount * roomSize; ++i)
+            {
+                BenchClient& c = *clients[i];
+                c.room = rooms[i / roomSize].get();
+                c.sender = i % roomSize == 0;
+                c.probe = i % roomSize == roomSize - 1;
+                c.warmed = false;
+                sendBlocking(c, encodeFrame(FrameType::Join, c.room->name));
+            }
+
+            Case run;
+            run.messageSize = messageSize;
+            run.window = s.window;
+            std::vector<LatencyHistogram> hists(s.threads);
+            std::vector<std::thread> workers;
+            for (int t = 0; t < s.threads; ++t)
+            {
+                std::vector<BenchClient*> mine;
+                for (size_t i = t; i < clients.size(); i += s.threads) mine.push_back(clients[i].get());
+                workers.emplace_back(worker, mine, std::ref(run), std::ref(hists[t]));
+            }
+
+            auto deadline = Clock::now() + std::chrono::duration<double>(s.timeout);
+            bool ready = false;
+            while (!ready && Clock::now() < deadline)
+            {
+                ready = true;
+                for (auto& room : rooms) ready = ready && room->warmed.load() >= room->members - 1;
+                if (!ready) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+
+            uint64_t expected = s.messages * (roomSize - 1);
+            auto begin = Clock::now();
+            uint64_t floodStart = floodBytes.load();
+            run.phase.store(Phase::Run, std::memory_order_release);
+            while (ready && run.delivered.load() < expected && Clock::now() < deadline)
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+            run.phase.store(Phase::Done, std::memory_order_release);
+            for (auto& w : workers) w.join();
+
+            LatencyHistogram hist;
+            for (auto& h : hists) hist.merge(h);
+            uint64_t delivered = run.delivered.load();
+            double msgsPerSec = delivered / double(roomSize - 1) / seconds;
+            double deliveriesPerSec = delivered / seconds;
+            double p50 = hist.percentile(50) / 1000.0;
+            double p99 = hist.percentile(99) / 1000.0;
+            double p999 = hist.percentile(99.9) / 1000.0;
+            double floodMbPerSec = (floodBytes.load() - floodStart) / seconds / 1e6;
+            long rss = readStatusKb(s.pid, "VmRSS:");
+            long hwm = readStatusKb(s.pid, "VmHWM:");
+
+            std::cout << std::left << std::fixed << std::setw(8) << roomSize << std::setw(8) << messageSize
+                      << std::setprecision(0) << std::setw(12) << msgsPerSec << std::setw(14) << deliveriesPerSec
+                      << std::setprecision(1) << std::setw(10) << p50 << std::setw(10) << p99 << std::setw(10) << p999
+                      << std::setw(10) << expected - delivered << rss << (ready ? "" : "  ⚠ rooms not ready") << std::endl;
+            results.push_back({roomSize, messageSize, msgsPerSec, p99});
+            std::cout << "RESULT " << (mode.empty() ? "" : "mode=" + mode + " ") << "room_size=" << roomSize << " message_size=" << messageSize << " clients=" << s.clients
+                      << std::setprecision(0) << " msgs_per_sec=" << msgsPerSec << " deliveries_per_sec=" << deliveriesPerSec
+                      << std::setprecision(1) << " p50_us=" << p50 << " p99_us=" << p99 << " p999_us=" << p999
+                      << " lost=" << expected - delivered << " server_rss_kb=" << rss << " server_hwm_kb=" << hwm;
+            if (s.flooders != 0) std::cout << " flooders=" << s.flooders << " flood_mb_per_sec=" << floodMbPerSec;
+            std::cout << std::endl;
+
+            for (int i = 0; i < roomCount * roomSize; ++i)
+            {
+                BenchClient& c = *clients[i];
+                sendBlocking(c, encodeFrame(FrameType::Leave, c.room->name));
+                c.room = nullptr;
+                c.sender = c.probe = false;
+            }
+        }
+    }
+
+    flooding = false;
+    if (floodThread.joinable()) floodThread.join();
+    for (int fd : flooders) close(fd);
+    for (auto& c : clients) close(c->fd);
+    if (owned)
+    {
+        kill(s.pid, SIGTERM);
+        waitpid(s.pid, nullptr, 0);
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    Settings s;
+    if (!parseArgs(argc, argv, s))
+    {
+        std::cerr << "Usage: " << argv[0] << " [--port=N] [--server=PATH | --pid=N] [--clients=K] [--threads=T]"
+                  << " [--room-sizes=A,B,..] [--message-sizes=A,B,..] [--messages=N] [--window=N] [--timeout=SEC]"
+                  << " [--modes=threaded,epoll,uring] [--mixed=H] [--flood-size=BYTES] [-- server options]" << std::endl;
+        return 1;
+    }
+
+    rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max; // K client sockets here, K more in a server we start
+    setrlimit(RLIMIT_NOFILE, &limit);
+
+    std::vector<CaseResult> results;
+    if (s.modes.empty()) return runSuite(s, "", results);
+
+    std::vector<std::vector<CaseResult>> byMode;
+    for (const std::string& mode : s.modes)
+    {
+        results.clear();
+        if (runSuite(s, mode, results) != 0) return 1;
+        byMode.push_back(results);
+        std::cout << std::endl;
+    }
+
+    std::cout << "=== Mode comparison: msgs/s (p99 us) ===" << std::endl;
+    std::cout << std::left << std::setw(8) << "room" << std::setw(8) << "bytes";
+    for (const std::string& mode : s.modes) std::cout << std::setw(22) << mode;
+    std::cout << std::endl;
+    for (size_t c = 0; c < byMode[0].size(); ++c)
+    {
+        std::cout << std::setw(8) << byMode[0][c].roomSize << std::setw(8) << byMode[0][c].messageSize;
+        for (const std::vector<CaseResult>& mode : byMode)
+        {
+            if (c >= mode.size()) continue;
+            std::ostringstream cell;
+            cell << std::fixed << std::setprecision(0) << mode[c].msgsPerSec << " (" << std::setprecision(1) << mode[c].p99 << ")";
+            std::cout << std::setw(22) << cell.str();
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -1,4 +1,10 @@
 #include "client.h"
+#include "frame.h"
+#include "mpsc_ring.h"
+#include <netinet/tcp.h>
+#include <algorithm>
+#include <climits>
+#include <poll.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netdb.h> 
@@ -9,8 +15,8 @@
 #include <cstring>
 #include <errno.h>
 
-Client::Client(const std::string& host, int port, const std::string& name)
-    : host_(host), port_(port), name_(name), sockfd_(-1), running_(false) {} // Constructor
+Client::Client(const std::string& host, int port, const std::string& name, const ClientOptions& options)
+    : host_(host), port_(port), name_(name), options_(options), sockfd_(-1), running_(false) {} // Constructor
 
 Client::~Client() 
 {
@@ -61,15 +67,49 @@ bool Client::connectToServer()
         return false;
     }
 
+    if (options_.noDelay)
+    {
+        int one = 1;
+        setsockopt(sockfd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // Small frames leave immediately
+    }
+
+    decoder_.reset(); // A new connection starts with a new name table
+    names_.clear();
+    {
+        std::lock_guard<std::mutex> lock(rooms_mutex_);
+        room_ids_.clear();
+        room_names_.clear();
+    }
+    session_id_ = 0;
+    sequence_ = 0;
+
+    if (!name_.empty() && !handshake())
+    {
+        if (!on_message_) std::cerr << "✗ Handshake with " << host_ << ":" << port_ << " failed" << std::endl;
+        close(sockfd_);
+        sockfd_ = -1;
+        return false;
+    }
+
     running_ = true;
     if (recv_thread_.joinable()) { recv_thread_.join(); } // Join any existing thread
     recv_thread_ = std::thread(&Client::receiveLoop, this); // Start the receive thread
 
+    if (options_.asyncSend)
+    {
+        timeval timeout{1, 0};
+        setsockopt(sockfd_, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)); // A stuck peer can't hang disconnect()
+        send_queue_ = std::make_unique<MpscRing>(options_.queueCapacity);
+        send_running_ = true;
+        send_thread_ = std::thread(&Client::sendLoop, this);
+    }
+
     return true;
 }
 
 void Client::disconnect() 
 {
+    stopWriter(); // Queued frames go out before the socket closes
     running_ = false;  // Stop the receive loop
 
     if (sockfd_ != -1) 
@@ -111,54 +151,431 @@ void Client::disconnect()
 
 bool Client::isConnected() const { return running_ && sockfd_ != -1;}
 
-bool Client::sendAll(const char* data, size_t len) 
+bool Client::writeAll(iovec* iov, int count) 
 {
-    size_t totalSent = 0; // Total bytes sent so far
-    while (totalSent < len) 
+    while (count > 0) 
     {
-        ssize_t sent = send(sockfd_, data + totalSent, len - totalSent, 0); // Send remaining data
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = static_cast<size_t>(count);
+        ssize_t sent = sendmsg(sockfd_, &msg, MSG_NOSIGNAL); // One syscall for the whole batch
+        if (sent < 0 && (errno == EINTR || ((errno == EAGAIN || errno == EWOULDBLOCK) && send_running_))) continue;
         if (sent <= 0) 
         {
             return false; // error or connection closed
         }
-        totalSent += static_cast<size_t>(sent);
+
+        size_t left = static_cast<size_t>(sent);
+        while (count > 0 && left >= iov->iov_len) // Skip the iovecs that went out completely
+        {
+            left -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+        if (count > 0)
+        {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + left;
+            iov->iov_len -= left;
+        }
     }
     return true;
 }
 
-bool Client::sendMessage(const std::string& message) // Send a string message to the server
+bool Client::sendFrame(std::initializer_list<std::string_view> parts)
 {
     if (!isConnected()) return false;
-    std::string out = message;
-    if (!name_.empty()) { out = name_ + ": " + message; } // Add client's name
-    return sendAll(out.c_str(), out.size()); // Send raw bytes. Server reads and broadcasts them.
+
+    if (!options_.asyncSend) // Write straight from the caller's buffers, no concatenated copy
+    {
+        iovec iov[8];
+        int count = 0;
+        for (std::string_view part : parts)
+        {
+            iov[count].iov_base = const_cast<char*>(part.data());
+            iov[count].iov_len = part.size();
+            ++count;
+        }
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        return writeAll(iov, count);
+    }
+
+    SharedMessage frame = SharedMessage::create(parts, FRAME_HEADER_SIZE, sockfd_); // The only copy
+    if (!send_queue_->tryPush(frame)) // Never block the caller: the writer is behind
+    {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    std::atomic_thread_fence(std::memory_order_seq_cst); // Pairs with the writer's fence before it sleeps
+    if (send_sleeping_.load(std::memory_order_relaxed))
+    {
+        std::lock_guard<std::mutex> lock(send_mutex_);
+        send_cv_.notify_one();
+    }
+    return true;
+}
+
+bool Client::sendControl(std::string_view frame)
+{
+    if (options_.asyncSend) return sendFrame({frame}); // The writer thread is the only one touching the socket
+
+    std::unique_lock<std::mutex> lock(write_mutex_, std::try_to_lock);
+    if (!lock.owns_lock()) return false; // The caller is writing, the server hears from us anyway
+    ssize_t sent = send(sockfd_, frame.data(), frame.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (sent == static_cast<ssize_t>(frame.size())) return true;
+    if (sent <= 0) return false; // Full socket: the server isn't reading, a probe wouldn't get through either
+
+    iovec rest{const_cast<char*>(frame.data()) + sent, frame.size() - static_cast<size_t>(sent)}; // Never leave half a frame
+    return writeAll(&rest, 1);
+}
+
+size_t Client::encodeHeader(char* out, uint32_t room)
+{
+    uint64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    MessageHeader header;
+    header.sender = session_id_;
+    header.room = room;
+    header.sequence = ++sequence_;
+    header.timestamp = now > epoch_ms_ ? now - epoch_ms_ : 0;
+    return encodeMessageHeader(out, header);
+}
+
+bool Client::sendCompact(uint32_t room, const std::string& message)
+{
+    if (message.size() + MAX_MESSAGE_HEADER > MAX_FRAME_PAYLOAD) return false; // Server would reject the frame
+
+    char head[FRAME_HEADER_SIZE + MAX_MESSAGE_HEADER];
+    size_t headerLen = encodeHeader(head + FRAME_HEADER_SIZE, room);
+    encodeFrameHeader(head, FrameType::Message, headerLen + message.size());
+    return sendFrame({std::string_view(head, FRAME_HEADER_SIZE + headerLen), message});
+}
+
+bool Client::sendDirect(const std::string& to, const std::string& message)
+{
+    if (session_id_ == 0 || to.empty() || to.size() > MAX_NICKNAME) return false; // The recipient has to see who wrote
+    if (1 + to.size() + MAX_MESSAGE_HEADER + message.size() > MAX_FRAME_PAYLOAD) return false;
+
+    char head[FRAME_HEADER_SIZE + 1];
+    char header[MAX_MESSAGE_HEADER];
+    size_t headerLen = encodeHeader(header, 0);
+    encodeFrameHeader(head, FrameType::Direct, 1 + to.size() + headerLen + message.size());
+    head[FRAME_HEADER_SIZE] = static_cast<char>(to.size());
+    return sendFrame({std::string_view(head, sizeof(head)), to, std::string_view(header, headerLen), message});
+}
+
+bool Client::sendMessage(const std::string& message) // Send a string message to the server
+{
+    if (session_id_ != 0) return sendCompact(0, message); // The server knows our name already
+    size_t payloadLen = message.size() + (name_.empty() ? 0 : name_.size() + 2);
+    if (payloadLen > MAX_FRAME_PAYLOAD) return false; // Server would reject the frame
+
+    char header[FRAME_HEADER_SIZE];
+    encodeFrameHeader(header, FrameType::Chat, payloadLen);
+    std::string_view head(header, FRAME_HEADER_SIZE);
+    if (name_.empty()) return sendFrame({head, message});
+    return sendFrame({head, name_, ": ", message}); // Add client's name. Server decodes and broadcasts it.
+}
+
+bool Client::joinRoom(const std::string& room)
+{
+    if (room.empty() || room.size() > MAX_ROOM_NAME) return false;
+    char header[FRAME_HEADER_SIZE];
+    encodeFrameHeader(header, FrameType::Join, room.size());
+    return sendFrame({std::string_view(header, FRAME_HEADER_SIZE), room});
+}
+
+bool Client::leaveRoom(const std::string& room)
+{
+    if (room.empty() || room.size() > MAX_ROOM_NAME) return false;
+    char header[FRAME_HEADER_SIZE];
+    encodeFrameHeader(header, FrameType::Leave, room.size());
+    return sendFrame({std::string_view(header, FRAME_HEADER_SIZE), room});
+}
+
+bool Client::sendToRoom(const std::string& room, const std::string& message)
+{
+    if (room.empty() || room.size() > MAX_ROOM_NAME) return false;
+    if (session_id_ != 0)
+    {
+        uint32_t roomId = 0;
+        {
+            std::lock_guard<std::mutex> lock(rooms_mutex_);
+            auto it = room_ids_.find(room);
+            if (it != room_ids_.end()) roomId = it->second;
+        }
+        if (roomId != 0) return sendCompact(roomId, message); // Otherwise (not joined yet) the room goes by name
+    }
+
+    size_t textLen = message.size() + (name_.empty() ? 0 : name_.size() + 2);
+    if (1 + room.size() + textLen > MAX_FRAME_PAYLOAD) return false; // Server would reject the frame
+
+    char header[FRAME_HEADER_SIZE + 1];
+    encodeFrameHeader(header, FrameType::RoomChat, 1 + room.size() + textLen);
+    header[FRAME_HEADER_SIZE] = static_cast<char>(room.size());
+    std::string_view head(header, sizeof(header));
+    if (name_.empty()) return sendFrame({head, room, message});
+    return sendFrame({head, room, name_, ": ", message}); // Add client's name
+}
+
+void Client::sendLoop()
+{
+    size_t maxBatch = std::max<size_t>(1, std::min<size_t>(options_.maxBatch, IOV_MAX));
+    std::vector<SharedMessage> batch(maxBatch);
+    std::vector<iovec> iov(maxBatch);
+
+    while (true)
+    {
+        size_t count = send_queue_->popBatch(batch.data(), batch.size());
+        if (count == 0)
+        {
+            std::unique_lock<std::mutex> lock(send_mutex_);
+            if (!send_running_) break; // Queue drained after disconnect()
+
+            send_sleeping_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst); // A push after this fence sees send_sleeping_
+            send_cv_.wait(lock, [this]() { return !send_running_ || send_queue_->size() > 0; });
+            send_sleeping_.store(false, std::memory_order_relaxed);
+            lock.unlock();
+
+            if (options_.flushDeadline.count() > 0 && send_running_ && send_queue_->size() < maxBatch)
+                std::this_thread::sleep_for(options_.flushDeadline); // Let a burst gather into one batch
+            continue;
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            iov[i].iov_base = const_cast<char*>(batch[i].data());
+            iov[i].iov_len = batch[i].size();
+        }
+
+        if (writeAll(iov.data(), static_cast<int>(count)))
+        {
+            sent_.fetch_add(count, std::memory_order_relaxed);
+            batches_.fetch_add(1, std::memory_order_relaxed);
+            if (count > largest_batch_.load(std::memory_order_relaxed)) largest_batch_.store(count, std::memory_order_relaxed);
+        }
+        else
+        {
+            dropped_.fetch_add(count, std::memory_order_relaxed); // The receive loop notices the dead socket
+        }
+        for (size_t i = 0; i < count; ++i) batch[i] = SharedMessage(); // Release the frames
+    }
+}
+
+void Client::stopWriter()
+{
+    if (!send_thread_.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(send_mutex_);
+        send_running_ = false;
+    }
+    send_cv_.notify_one();
+    send_thread_.join();
+}
+
+ClientSendStats Client::sendStats() const
+{
+    return ClientSendStats{send_queue_ ? send_queue_->size() : 0, sent_.load(std::memory_order_relaxed),
+                           batches_.load(std::memory_order_relaxed), largest_batch_.load(std::memory_order_relaxed),
+                           dropped_.load(std::memory_order_relaxed)};
+}
+
+void Client::setMessageHandler(MessageHandler handler) { on_message_ = std::move(handler); }
+
+bool Client::handshake()
+{
+    char header[FRAME_HEADER_SIZE];
+    encodeFrameHeader(header, FrameType::Hello, name_.size());
+    iovec iov[2] = {{header, FRAME_HEADER_SIZE}, {const_cast<char*>(name_.data()), name_.size()}};
+    if (!writeAll(iov, 2)) return false;
+
+    auto deadline = std::chrono::steady_clock::now() + HANDSHAKE_TIMEOUT;
+    while (session_id_ == 0) // Names and history sent at accept come first and are handled as usual
+    {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (left <= 0) return false;
+
+        pollfd pfd{sockfd_, POLLIN, 0};
+        int rc = poll(&pfd, 1, static_cast<int>(left));
+        if (rc < 0 && errno == EINTR) continue;
+        if (rc <= 0) return false;
+
+        char* buffer = decoder_.writePtr(RECV_BUFFER_SIZE);
+        ssize_t recvd = recv(sockfd_, buffer, decoder_.writable(), 0);
+        if (recvd < 0 && errno == EINTR) continue;
+        if (recvd <= 0) return false;
+        decoder_.commit(static_cast<size_t>(recvd));
+
+        FrameView frame;
+        FrameDecoder::Status status;
+        while ((status = decoder_.next(frame)) == FrameDecoder::Status::Frame) dispatch(frame); // Leaves no complete frame behind
+        if (status == FrameDecoder::Status::Error) return false;
+    }
+    return true;
+}
+
+void Client::dispatch(const FrameView& frame)
+{
+    ClientMessage message{frame.type, std::string_view(), frame.payload};
+
+    switch (frame.type)
+    {
+    case FrameType::Welcome:
+    {
+        std::string_view payload = frame.payload;
+        uint64_t id, epoch;
+        if (getVarint(payload, id) && getVarint(payload, epoch) && id != 0 && id <= UINT32_MAX)
+        {
+            epoch_ms_ = epoch;
+            session_id_ = static_cast<uint32_t>(id);
+        }
+        return;
+    }
+    case FrameType::Name:
+    {
+        std::string_view payload = frame.payload, name;
+        NameKind kind;
+        uint32_t id;
+        while (nextNameEntry(payload, kind, id, name))
+        {
+            if (kind == NameKind::User)
+            {
+                if (name.empty()) names_.erase(id); // User left
+                else names_[id].assign(name.data(), name.size());
+            }
+            else if (kind == NameKind::Room)
+            {
+                std::lock_guard<std::mutex> lock(rooms_mutex_);
+                room_ids_[std::string(name)] = id;
+                room_names_[id].assign(name.data(), name.size());
+            }
+        }
+        return;
+    }
+    case FrameType::Ping:
+        sendControl(encodeFrame(FrameType::Pong, frame.payload));
+        return;
+    case FrameType::Chat:
+        break;
+    case FrameType::RoomChat:
+        if (!parseRoomPayload(frame.payload, message.room, message.text))
+            message = ClientMessage{frame.type, std::string_view(), frame.payload}; // Malformed: pass it on whole
+        break;
+    case FrameType::Message:
+    case FrameType::Direct:
+    {
+        MessageHeader header;
+        std::string_view to;
+        if (frame.type == FrameType::Message ? !parseMessagePayload(frame.payload, header, message.text)
+                                             : !parseDirectPayload(frame.payload, to, header, message.text)) return;
+        auto sender = names_.find(header.sender);
+        if (sender != names_.end()) message.sender = sender->second;
+        if (header.room != 0)
+        {
+            auto room = room_names_.find(header.room);
+            if (room == room_names_.end()) return; // A room we never joined
+            message.room = room->second;
+        }
+        message.senderId = header.sender;
+        message.sequence = header.sequence;
+        message.timestampMs = epoch_ms_ + header.timestamp;
+        break;
+    }
+    default:
+        return; // Unknown types are ignored
+    }
+
+    if (on_message_)
+    {
+        on_message_(message); // Views into the decoder's buffer, no copy
+        return;
+    }
+    if (!message.room.empty()) std::cout << "[" << message.room << "] "; // Room messages carry their room
+    if (frame.type == FrameType::Direct) std::cout << "[DM] ";
+    if (frame.type == FrameType::Message || frame.type == FrameType::Direct)
+    {
+        if (message.sender.empty()) std::cout << "#" << message.senderId << ": ";
+        else std::cout << message.sender << ": ";
+    }
+    std::cout << message.text << std::endl; // Print received message to stdout
+}
+
+bool Client::awaitServer(std::chrono::steady_clock::time_point heard, std::chrono::steady_clock::time_point& pinged)
+{
+    using namespace std::chrono;
+
+    while (running_)
+    {
+        auto now = steady_clock::now();
+        if (options_.idleTimeout.count() > 0 && now - heard >= options_.idleTimeout) return false;
+
+        auto next = steady_clock::time_point::max();
+        if (options_.idleTimeout.count() > 0) next = heard + options_.idleTimeout;
+        if (options_.heartbeat.count() > 0)
+        {
+            if (now - heard >= options_.heartbeat && now - pinged >= options_.heartbeat) // Quiet server: ask whether it's there
+            {
+                char ping[FRAME_HEADER_SIZE];
+                encodeFrameHeader(ping, FrameType::Ping, 0);
+                sendControl(std::string_view(ping, FRAME_HEADER_SIZE));
+                pinged = now;
+            }
+            next = std::min(next, std::max(heard, pinged) + options_.heartbeat);
+        }
+
+        auto wait = duration_cast<milliseconds>(next - now).count() + 1; // Round up, poll() would wake just too early
+        pollfd pfd{sockfd_, POLLIN, 0};
+        int rc = poll(&pfd, 1, static_cast<int>(std::min<long long>(wait, INT_MAX)));
+        if (rc != 0 && !(rc < 0 && errno == EINTR)) return true; // Data, hangup or an error recv() reports
+    }
+    return true; // disconnect(): recv() sees the shutdown
 }
 
 void Client::receiveLoop()
 {
-    const size_t BUF_SIZE = 4096; // Buffer size for receiving data
-    char buffer[BUF_SIZE]; // Receive buffer
+    const bool quiet = static_cast<bool>(on_message_); // Embedded use: no stdout/stderr writes
+    const bool watch = options_.heartbeat.count() > 0 || options_.idleTimeout.count() > 0;
+    auto heard = std::chrono::steady_clock::now(); // Last data from the server
+    auto pinged = heard;
 
     while (running_)  
     {
-        memset(buffer, 0, BUF_SIZE); // Clear the buffer
-        ssize_t recvd = recv(sockfd_, buffer, BUF_SIZE, 0); // Receive data
+        if (watch && !awaitServer(heard, pinged))
+        {
+            if (!quiet) std::cerr << "✗ Server not responding, disconnecting" << std::endl;
+            running_ = false;
+            shutdown(sockfd_, SHUT_RDWR); // A caller blocked sending to the dead peer gets an error
+            break;
+        }
+
+        char* buffer = decoder_.writePtr(RECV_BUFFER_SIZE); // Reused for the whole connection, grows to the largest frame
+        ssize_t recvd = recv(sockfd_, buffer, decoder_.writable(), 0); // Receive data
         if (recvd > 0) // Data received
         {
-            // Print received message to stdout
-            std::string msg(buffer, static_cast<size_t>(recvd)); // Convert to string
-            std::cout << msg << std::endl;
+            decoder_.commit(static_cast<size_t>(recvd));
+            heard = std::chrono::steady_clock::now();
+
+            FrameView frame;
+            FrameDecoder::Status status;
+            while ((status = decoder_.next(frame)) == FrameDecoder::Status::Frame) dispatch(frame);
+
+            if (status == FrameDecoder::Status::Error)
+            {
+                if (!quiet) std::cerr << "✗ Received an invalid frame" << std::endl;
+                running_ = false;
+                break;
+            }
         } 
         else if (recvd == 0) 
         {
-            std::cout << "⚠ Server closed connection" << std::endl;
+            if (!quiet) std::cout << "⚠ Server closed connection" << std::endl;
             running_ = false;
             break;
         } 
         else 
         {
             if (errno == EINTR) continue; // Interrupted, retry
-            std::cerr << "✗ Receive function: " << strerror(errno) << std::endl;
+            if (!quiet && running_) std::cerr << "✗ Receive function: " << strerror(errno) << std::endl; // Not after disconnect()
             running_ = false;
             break;
         }
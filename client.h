@@ -1,27 +1,115 @@
+#pragma once
+
 #include <string>
 #include <thread>
 #include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <unordered_map>
+#include <sys/uio.h>
+#include "message_buffer.h"
+#include "frame.h"
+
+class MpscRing;
+
+constexpr size_t RECV_BUFFER_SIZE = 16 * 1024; // Free space offered to each recv()
+constexpr std::chrono::seconds HANDSHAKE_TIMEOUT{5}; // connectToServer() gives up waiting for Welcome after this
+
+struct ClientOptions
+{
+    bool asyncSend = false; // Queue sends; a writer thread coalesces them into writev batches
+    bool noDelay = false; // Set TCP_NODELAY (disable Nagle's algorithm)
+    std::chrono::microseconds flushDeadline{0}; // Async: how long the writer waits for more messages after waking
+    size_t queueCapacity = 4096; // Async: messages waiting to be written, sends fail when it is full
+    size_t maxBatch = 64; // Async: messages per writev call at most
+    std::chrono::milliseconds heartbeat{0}; // Ping a server that has sent nothing for this long, 0 never pings
+    std::chrono::milliseconds idleTimeout{0}; // Disconnect from a server silent for this long (dead or unreachable), 0 waits forever
+};
+
+struct ClientSendStats
+{
+    size_t queued; // Messages waiting for the writer
+    uint64_t sent; // Messages written
+    uint64_t batches; // writev batches written (sent / batches = average batch)
+    uint64_t largestBatch; // Messages in the largest batch
+    uint64_t dropped; // Messages refused because the queue was full or the socket failed
+};
+
+struct ClientMessage // One received message. Views into the receive buffer, valid only during the callback
+{
+    FrameType type; // Message (or Direct) from a handshaken sender, Chat/RoomChat from one without a name
+    std::string_view room; // Room name, empty for messages to everyone
+    std::string_view text; // Message text, "name: message" for Chat/RoomChat
+    std::string_view sender = {}; // Sender's name from the name table (Message/Direct only, empty if unknown)
+    uint32_t senderId = 0; // Sender's session id (Message/Direct only)
+    uint64_t sequence = 0; // Sender's message counter (Message/Direct only)
+    uint64_t timestampMs = 0; // Sender's clock, ms since 1970 (Message/Direct only)
+};
+
+using MessageHandler = std::function<void(const ClientMessage&)>;
 
 class Client {
 public:
-    
-    Client(const std::string& host, int port, const std::string& name = ""); // Constructor
+
+    Client(const std::string& host, int port, const std::string& name = "", const ClientOptions& options = ClientOptions()); // Constructor
     ~Client(); // Destructor
 
     bool connectToServer(); // Connect to the server. Returns true on success.
     void disconnect(); // Disconnect and cleanup from server
     bool sendMessage(const std::string& message); // Send a single message (strings only)
+    bool joinRoom(const std::string& room); // Receive the messages sent to a room
+    bool leaveRoom(const std::string& room); // Stop receiving a room's messages
+    bool sendToRoom(const std::string& room, const std::string& message); // Send a message to a room's members only
+    bool sendDirect(const std::string& to, const std::string& message); // Send to one nickname only, needs a name (handshake)
     bool isConnected() const; // Check if the client is connected to the server
+    ClientSendStats sendStats() const; // Async send queue depth and batching counters
+    void setMessageHandler(MessageHandler handler); // Call before connectToServer(). Replaces printing to stdout
+    uint32_t sessionId() const { return session_id_; } // Id from the handshake, 0 without a name or connection
 
 private:
     void receiveLoop(); // Thread function to receive messages while running
-    bool sendAll(const char* data, size_t len); // Ensure message's data are sent
+    void sendLoop(); // Async mode: drain the queue into writev batches
+    bool sendFrame(std::initializer_list<std::string_view> parts); // Send or queue one frame given in pieces
+    bool sendControl(std::string_view frame); // Ping/Pong from the receive thread, never waits behind the caller or a full socket
+    bool awaitServer(std::chrono::steady_clock::time_point heard, std::chrono::steady_clock::time_point& pinged); // Heartbeats: wait for data, false on idle timeout
+    bool writeAll(iovec* iov, int count); // Write every iovec, resuming after partial writes
+    void stopWriter(); // Let the writer drain the queue and join it
+    bool handshake(); // Named clients: send Hello and read until Welcome arrives
+    void dispatch(const FrameView& frame); // Act on one received frame
+    bool sendCompact(uint32_t room, const std::string& message); // Message frame with a varint header
+    size_t encodeHeader(char* out, uint32_t room); // Next MessageHeader for this client, returns its length
 
     std::string host_; // Server hostname or IP
     int port_; // Server port
     std::string name_; // Client's name
+    ClientOptions options_; // Send mode and batching settings
     int sockfd_; // Socket file descriptor
 
     std::thread recv_thread_; // Thread for receiving messages
     std::atomic<bool> running_; // Flag to control the receive thread
+    MessageHandler on_message_; // Receives every message when set, otherwise they are printed
+    FrameDecoder decoder_{RECV_BUFFER_SIZE}; // Used by handshake() and then by the receive thread
+
+    std::atomic<uint32_t> session_id_{0}; // From Welcome
+    uint64_t epoch_ms_ = 0; // Server epoch from Welcome, Message timestamps count from it
+    std::atomic<uint64_t> sequence_{0}; // Last Message sequence sent
+    std::unordered_map<uint32_t, std::string> names_; // Session id -> nickname (receive side only)
+    std::mutex rooms_mutex_; // Room ids are learned by the receive thread and read by senders
+    std::unordered_map<std::string, uint32_t> room_ids_;
+    std::unordered_map<uint32_t, std::string> room_names_; // Only written by the receive side, which reads it unlocked
+
+    std::mutex write_mutex_; // Sync mode: the receive thread's Pings and Pongs don't interleave with the caller's frames
+    std::unique_ptr<MpscRing> send_queue_; // Async mode: frames waiting for the writer (lock-free, many senders)
+    std::thread send_thread_; // Async mode: thread running sendLoop()
+    std::mutex send_mutex_; // Writer sleep/wake handshake
+    std::condition_variable send_cv_; // Writer waits here when the queue is empty
+    std::atomic<bool> send_sleeping_{false}; // Writer is (about to be) waiting on send_cv_
+    std::atomic<bool> send_running_{false}; // Cleared by disconnect() to stop the writer
+    std::atomic<uint64_t> sent_{0};
+    std::atomic<uint64_t> batches_{0};
+    std::atomic<uint64_t> largest_batch_{0};
+    std::atomic<uint64_t> dropped_{0};
 };
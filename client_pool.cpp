@@ -0,0 +1,605 @@
+#include "client_pool.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <queue>
+
+constexpr size_t POOL_RECV_CHUNK = 4096; // Free space offered to each recv(), kept small: one buffer per session
+constexpr size_t POOL_EVENT_BATCH = 256; // Events taken per epoll_wait()
+constexpr size_t OUTBOX_COMPACT = 64 * 1024; // Written bytes kept at the front of an outbox before erasing them
+
+enum class SessionState : int { Waiting, Connecting, Connected, Closed };
+
+struct ClientPool::Session
+{
+    SessionId id;
+    Loop* loop; // Owning event loop
+    sockaddr_storage addr; // Resolved once in open()
+    socklen_t addrLen;
+    std::string name; // Sent in Hello, empty for anonymous sessions
+    std::string prefix; // "name: " or empty, used until the handshake completes
+    std::shared_ptr<NameMap> names; // Shared with every session to the same server
+    std::atomic<SessionState> state{SessionState::Waiting};
+    std::chrono::milliseconds backoff; // Next reconnect delay (loop thread only)
+    FrameDecoder decoder{0}; // Loop thread only, grows on the first read
+
+    std::mutex mutex; // Everything below
+    int fd = -1; // Only changed by the loop thread
+    std::string outbox; // Framed bytes not yet written
+    size_t written = 0; // Bytes of outbox already on the wire
+    std::vector<std::string> rooms; // Rejoined after a reconnect
+    bool closing = false; // close() was called
+    uint32_t session_id = 0; // From Welcome, 0 until the handshake completes on this connection
+    uint64_t epoch_ms = 0; // Server epoch from Welcome
+    uint64_t sequence = 0; // Last Message sequence sent
+};
+
+struct ClientPool::NameMap
+{
+    std::shared_mutex mutex; // Written when a Name frame brings news, read for every Message
+    std::unordered_map<uint32_t, std::string> users;
+    std::unordered_map<std::string, uint32_t> room_ids;
+    std::unordered_map<uint32_t, std::string> room_names;
+};
+
+struct ClientPool::Loop
+{
+    using Retry = std::pair<std::chrono::steady_clock::time_point, Session*>;
+
+    int epoll_fd = -1;
+    int wake_fd = -1; // Registered with a null data pointer
+    std::thread thread;
+    std::mutex mutex; // Guards posted
+    std::vector<Session*> posted; // Sessions to connect or close
+    std::priority_queue<Retry, std::vector<Retry>, std::greater<Retry>> retries; // Loop thread only
+};
+
+ClientPool::ClientPool(const PoolOptions& options) : options_(options) // Constructor
+{
+    if (options_.threads == 0) options_.threads = 1;
+    for (size_t i = 0; i < options_.threads; ++i)
+    {
+        auto loop = std::make_unique<Loop>();
+        loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        loop->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = nullptr;
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->wake_fd, &ev);
+        loops_.push_back(std::move(loop));
+    }
+}
+
+ClientPool::~ClientPool() // Destructor
+{
+    stop();
+    for (auto& session : sessions_)
+    {
+        if (session->fd != -1) ::close(session->fd);
+    }
+    for (auto& loop : loops_)
+    {
+        ::close(loop->wake_fd);
+        ::close(loop->epoll_fd);
+    }
+}
+
+void ClientPool::setMessageHandler(SessionMessageHandler handler) { on_message_ = std::move(handler); }
+
+void ClientPool::setStateHandler(SessionStateHandler handler) { on_state_ = std::move(handler); }
+
+void ClientPool::start()
+{
+    if (running_.exchange(true)) return;
+    for (auto& loop : loops_)
+    {
+        Loop* l = loop.get();
+        l->thread = std::thread([this, l]() { runLoop(*l); });
+    }
+}
+
+void ClientPool::stop()
+{
+    if (!running_.exchange(false)) return;
+    for (auto& loop : loops_)
+    {
+        uint64_t one = 1;
+        (void)!write(loop->wake_fd, &one, sizeof(one)); // Wake it so it sees running_ == false
+    }
+    for (auto& loop : loops_)
+    {
+        if (loop->thread.joinable()) loop->thread.join();
+    }
+
+    // The loops are gone: close what they still owned
+    for (auto& session : sessions_)
+    {
+        std::lock_guard<std::mutex> lock(session->mutex);
+        if (session->fd != -1)
+        {
+            ::close(session->fd);
+            session->fd = -1;
+        }
+        if (session->state.exchange(SessionState::Closed) == SessionState::Connected) connected_--;
+    }
+    open_ = 0;
+}
+
+SessionId ClientPool::open(const std::string& host, int port, const std::string& name)
+{
+    addrinfo hints{};
+    addrinfo* res = nullptr;
+    hints.ai_family = AF_UNSPEC; // IPv4 or IPv6
+    hints.ai_socktype = SOCK_STREAM;
+    std::string portStr = std::to_string(port);
+    if (getaddrinfo(host.c_str(), portStr.c_str(), &hints, &res) != 0 || res == nullptr) return INVALID_SESSION;
+
+    auto session = std::make_unique<Session>();
+    std::memcpy(&session->addr, res->ai_addr, res->ai_addrlen);
+    session->addrLen = res->ai_addrlen;
+    freeaddrinfo(res);
+    session->name = name;
+    if (!name.empty()) session->prefix = name + ": ";
+    session->backoff = options_.reconnectDelay;
+
+    Session* s = session.get();
+    {
+        std::unique_lock<std::shared_mutex> lock(sessions_mutex_);
+        std::shared_ptr<NameMap>& names = name_maps_[std::string(reinterpret_cast<const char*>(&s->addr), s->addrLen)];
+        if (!names) names = std::make_shared<NameMap>();
+        s->names = names;
+        s->id = static_cast<SessionId>(sessions_.size());
+        s->loop = loops_[s->id % loops_.size()].get();
+        sessions_.push_back(std::move(session));
+    }
+    open_++;
+    post(*s->loop, s);
+    return s->id;
+}
+
+void ClientPool::close(SessionId id)
+{
+    Session* s = find(id);
+    if (s == nullptr) return;
+    {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        if (s->closing) return;
+        s->closing = true;
+    }
+    post(*s->loop, s);
+}
+
+bool ClientPool::isConnected(SessionId id) const
+{
+    Session* s = find(id);
+    return s != nullptr && s->state.load() == SessionState::Connected;
+}
+
+ClientPool::Session* ClientPool::find(SessionId id) const
+{
+    std::shared_lock<std::shared_mutex> lock(sessions_mutex_);
+    return id < sessions_.size() ? sessions_[id].get() : nullptr; // Sessions live as long as the pool
+}
+
+bool ClientPool::queueFrame(Session& session, FrameType type, std::initializer_list<std::string_view> parts)
+{
+    size_t payloadLen = 0;
+    for (std::string_view part : parts) payloadLen += part.size();
+    if (payloadLen > MAX_FRAME_PAYLOAD) return false; // Server would reject the frame
+
+    if (session.fd == -1 || session.closing) return false; // Not connected, waiting to reconnect
+    if (session.outbox.size() - session.written + FRAME_HEADER_SIZE + payloadLen > options_.maxOutboxBytes) return false;
+
+    char header[FRAME_HEADER_SIZE];
+    encodeFrameHeader(header, type, payloadLen);
+    session.outbox.append(header, FRAME_HEADER_SIZE);
+    for (std::string_view part : parts) session.outbox.append(part.data(), part.size());
+
+    if (session.state.load() != SessionState::Connected) return true; // Written once the connect completes
+    return flush(session); // A failed socket is dropped by its loop (EPOLLERR/EPOLLHUP)
+}
+
+bool ClientPool::flush(Session& session)
+{
+    while (session.written < session.outbox.size())
+    {
+        ssize_t n = send(session.fd, session.outbox.data() + session.written, session.outbox.size() - session.written,
+                         MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0)
+        {
+            session.written += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            if (session.written >= OUTBOX_COMPACT) // Keep the outbox from growing while it never drains fully
+            {
+                session.outbox.erase(0, session.written);
+                session.written = 0;
+            }
+            return true; // The loop resumes on EPOLLOUT
+        }
+        return false;
+    }
+    session.outbox.clear(); // Keeps its capacity
+    session.written = 0;
+    return true;
+}
+
+size_t ClientPool::encodeHeader(Session& session, char* out, uint32_t room)
+{
+    uint64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    MessageHeader header;
+    header.sender = session.session_id;
+    header.room = room;
+    header.sequence = ++session.sequence;
+    header.timestamp = now > session.epoch_ms ? now - session.epoch_ms : 0;
+    return encodeMessageHeader(out, header);
+}
+
+bool ClientPool::queueMessage(Session& session, uint32_t room, const std::string& message)
+{
+    char head[MAX_MESSAGE_HEADER];
+    size_t headerLen = encodeHeader(session, head, room);
+    return queueFrame(session, FrameType::Message, {std::string_view(head, headerLen), message});
+}
+
+bool ClientPool::sendMessage(SessionId id, const std::string& message)
+{
+    Session* s = find(id);
+    if (s == nullptr) return false;
+    std::lock_guard<std::mutex> lock(s->mutex);
+    if (s->session_id != 0) return queueMessage(*s, 0, message);
+    return queueFrame(*s, FrameType::Chat, {s->prefix, message}); // Handshake not done (or anonymous)
+}
+
+bool ClientPool::joinRoom(SessionId id, const std::string& room)
+{
+    Session* s = find(id);
+    if (s == nullptr || room.empty() || room.size() > MAX_ROOM_NAME) return false;
+    std::lock_guard<std::mutex> lock(s->mutex);
+    if (std::find(s->rooms.begin(), s->rooms.end(), room) != s->rooms.end()) return true;
+    s->rooms.push_back(room);
+    queueFrame(*s, FrameType::Join, {room}); // Disconnected: joined on the next connect
+    return true;
+}
+
+bool ClientPool::leaveRoom(SessionId id, const std::string& room)
+{
+    Session* s = find(id);
+    if (s == nullptr) return false;
+    std::lock_guard<std::mutex> lock(s->mutex);
+    auto it = std::find(s->rooms.begin(), s->rooms.end(), room);
+    if (it == s->rooms.end()) return false;
+    s->rooms.erase(it);
+    queueFrame(*s, FrameType::Leave, {room}); // Disconnected: simply not rejoined
+    return true;
+}
+
+bool ClientPool::sendToRoom(SessionId id, const std::string& room, const std::string& message)
+{
+    Session* s = find(id);
+    if (s == nullptr || room.empty() || room.size() > MAX_ROOM_NAME) return false;
+    uint32_t roomId = 0;
+    {
+        std::shared_lock<std::shared_mutex> lock(s->names->mutex);
+        auto it = s->names->room_ids.find(room);
+        if (it != s->names->room_ids.end()) roomId = it->second;
+    }
+
+    char roomLen = static_cast<char>(room.size());
+    std::lock_guard<std::mutex> lock(s->mutex);
+    if (s->session_id != 0 && roomId != 0) return queueMessage(*s, roomId, message);
+    return queueFrame(*s, FrameType::RoomChat, {std::string_view(&roomLen, 1), room, s->prefix, message});
+}
+
+bool ClientPool::sendDirect(SessionId id, const std::string& to, const std::string& message)
+{
+    Session* s = find(id);
+    if (s == nullptr || to.empty() || to.size() > MAX_NICKNAME) return false;
+    char toLen = static_cast<char>(to.size());
+    char head[MAX_MESSAGE_HEADER];
+    std::lock_guard<std::mutex> lock(s->mutex);
+    if (s->session_id == 0) return false; // The recipient has to see who wrote
+    size_t headerLen = encodeHeader(*s, head, 0);
+    return queueFrame(*s, FrameType::Direct, {std::string_view(&toLen, 1), to, std::string_view(head, headerLen), message});
+}
+
+PoolStats ClientPool::stats() const
+{
+    return PoolStats{open_.load(), connected_.load(), connects_.load(), reconnects_.load()};
+}
+
+void ClientPool::post(Loop& loop, Session* session)
+{
+    {
+        std::lock_guard<std::mutex> lock(loop.mutex);
+        loop.posted.push_back(session);
+    }
+    uint64_t one = 1;
+    (void)!write(loop.wake_fd, &one, sizeof(one));
+}
+
+void ClientPool::runLoop(Loop& loop)
+{
+    epoll_event events[POOL_EVENT_BATCH];
+    std::vector<Session*> posted;
+
+    while (running_)
+    {
+        int timeout = -1; // Sleep until an event unless a reconnect is due
+        if (!loop.retries.empty())
+        {
+            auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(loop.retries.top().first - std::chrono::steady_clock::now());
+            timeout = static_cast<int>(std::max<int64_t>(0, wait.count()));
+        }
+
+        int n = epoll_wait(loop.epoll_fd, events, POOL_EVENT_BATCH, timeout);
+        if (n < 0 && errno != EINTR) break;
+
+        for (int i = 0; i < n; ++i)
+        {
+            if (events[i].data.ptr != nullptr)
+            {
+                handleEvent(loop, *static_cast<Session*>(events[i].data.ptr), events[i].events);
+                continue;
+            }
+
+            uint64_t count;
+            while (read(loop.wake_fd, &count, sizeof(count)) > 0) {} // Reset the eventfd
+            {
+                std::lock_guard<std::mutex> lock(loop.mutex);
+                posted.swap(loop.posted);
+            }
+            for (Session* s : posted)
+            {
+                bool closing;
+                {
+                    std::lock_guard<std::mutex> lock(s->mutex);
+                    closing = s->closing;
+                }
+                if (closing) dropSession(loop, *s);
+                else if (s->state.load() == SessionState::Waiting && s->fd == -1) connectSession(loop, *s);
+            }
+            posted.clear();
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        while (!loop.retries.empty() && loop.retries.top().first <= now)
+        {
+            Session* s = loop.retries.top().second;
+            loop.retries.pop();
+            if (s->state.load() == SessionState::Waiting && s->fd == -1) connectSession(loop, *s); // Closed meanwhile otherwise
+        }
+    }
+}
+
+void ClientPool::connectSession(Loop& loop, Session& session)
+{
+    int fd = socket(session.addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd != -1 && connect(fd, reinterpret_cast<sockaddr*>(&session.addr), session.addrLen) == -1 && errno != EINPROGRESS)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+    if (fd == -1) // Refused right away: same as a failed connect
+    {
+        dropSession(loop, session);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(session.mutex);
+        session.fd = fd;
+        session.outbox.clear();
+        session.written = 0;
+        if (!session.name.empty()) queueFrame(session, FrameType::Hello, {session.name}); // Welcome arrives after the connect
+        for (const std::string& room : session.rooms) queueFrame(session, FrameType::Join, {room}); // Rejoin after a reconnect
+    }
+    session.state = SessionState::Connecting;
+
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET; // EPOLLOUT reports the connect result, then free space
+    ev.data.ptr = &session;
+    epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+void ClientPool::handleEvent(Loop& loop, Session& session, uint32_t events)
+{
+    bool failed = false;
+
+    if (session.state.load() == SessionState::Connecting)
+    {
+        int error = 0;
+        socklen_t len = sizeof(error);
+        getsockopt(session.fd, SOL_SOCKET, SO_ERROR, &error, &len);
+        if (error != 0 || (events & (EPOLLERR | EPOLLHUP)))
+        {
+            dropSession(loop, session);
+            return;
+        }
+        if (!(events & (EPOLLOUT | EPOLLIN))) return;
+
+        {
+            std::lock_guard<std::mutex> lock(session.mutex);
+            session.state = SessionState::Connected;
+            failed = !flush(session); // Frames queued while connecting
+        }
+        session.backoff = options_.reconnectDelay;
+        connected_++;
+        connects_++;
+        if (on_state_) on_state_(session.id, true);
+    }
+
+    if (!failed && (events & (EPOLLIN | EPOLLRDHUP))) readSession(session, failed);
+    if (!failed && (events & EPOLLOUT))
+    {
+        std::lock_guard<std::mutex> lock(session.mutex);
+        failed = !flush(session);
+    }
+    if (failed || (events & (EPOLLERR | EPOLLHUP))) dropSession(loop, session);
+}
+
+void ClientPool::readSession(Session& session, bool& failed)
+{
+    while (true) // Edge-triggered: read until the socket is empty
+    {
+        char* buffer = session.decoder.writePtr(POOL_RECV_CHUNK);
+        ssize_t recvd = recv(session.fd, buffer, session.decoder.writable(), 0);
+        if (recvd > 0)
+        {
+            session.decoder.commit(static_cast<size_t>(recvd));
+
+            FrameView frame;
+            FrameDecoder::Status status;
+            while ((status = session.decoder.next(frame)) == FrameDecoder::Status::Frame) dispatch(session, frame);
+            if (status == FrameDecoder::Status::Error) failed = true;
+            if (failed) return;
+            continue;
+        }
+        if (recvd < 0 && errno == EINTR) continue;
+        if (recvd < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        failed = true; // Server closed the connection or the socket failed
+        return;
+    }
+}
+
+void ClientPool::dispatch(Session& session, const FrameView& frame)
+{
+    thread_local std::string sender, room; // Copied out of the shared name map, reused per loop thread
+    ClientMessage message{frame.type, std::string_view(), frame.payload};
+    NameMap& names = *session.names;
+
+    switch (frame.type)
+    {
+    case FrameType::Welcome:
+    {
+        std::string_view payload = frame.payload;
+        uint64_t id, epoch;
+        if (!getVarint(payload, id) || !getVarint(payload, epoch) || id == 0 || id > UINT32_MAX) return;
+        std::lock_guard<std::mutex> lock(session.mutex);
+        session.epoch_ms = epoch;
+        session.session_id = static_cast<uint32_t>(id);
+        return;
+    }
+    case FrameType::Name:
+    {
+        std::string_view payload = frame.payload, name;
+        NameKind kind;
+        uint32_t id;
+        while (nextNameEntry(payload, kind, id, name))
+        {
+            { // Every session to this server gets the same entry: only the first one writes
+                std::shared_lock<std::shared_mutex> lock(names.mutex);
+                if (kind == NameKind::User)
+                {
+                    auto it = names.users.find(id);
+                    if (name.empty() ? it == names.users.end() : (it != names.users.end() && it->second == name)) continue;
+                }
+                else if (names.room_names.count(id)) continue;
+            }
+
+            std::unique_lock<std::shared_mutex> lock(names.mutex);
+            if (kind == NameKind::User && name.empty()) names.users.erase(id);
+            else if (kind == NameKind::User) names.users[id].assign(name.data(), name.size());
+            else if (kind == NameKind::Room)
+            {
+                names.room_ids[std::string(name)] = id;
+                names.room_names[id].assign(name.data(), name.size());
+            }
+        }
+        return;
+    }
+    case FrameType::Ping:
+    {
+        std::lock_guard<std::mutex> lock(session.mutex);
+        queueFrame(session, FrameType::Pong, {frame.payload}); // Heartbeat, a failed socket is dropped by the loop
+        return;
+    }
+    case FrameType::Chat:
+        break;
+    case FrameType::RoomChat:
+        if (!parseRoomPayload(frame.payload, message.room, message.text))
+            message = ClientMessage{frame.type, std::string_view(), frame.payload}; // Malformed: pass it on whole
+        break;
+    case FrameType::Message:
+    case FrameType::Direct:
+    {
+        MessageHeader header;
+        std::string_view to;
+        if (!on_message_) return;
+        if (frame.type == FrameType::Message ? !parseMessagePayload(frame.payload, header, message.text)
+                                             : !parseDirectPayload(frame.payload, to, header, message.text)) return;
+        {
+            std::shared_lock<std::shared_mutex> lock(names.mutex);
+            auto it = names.users.find(header.sender);
+            if (it != names.users.end()) sender.assign(it->second); else sender.clear();
+            if (header.room != 0)
+            {
+                auto r = names.room_names.find(header.room);
+                if (r == names.room_names.end()) return; // A room this pool never joined
+                room.assign(r->second);
+            }
+        }
+        message.sender = sender;
+        if (header.room != 0) message.room = room;
+        message.senderId = header.sender;
+        message.sequence = header.sequence;
+        {
+            std::lock_guard<std::mutex> lock(session.mutex); // Senders read it while encoding their headers
+            message.timestampMs = session.epoch_ms + header.timestamp;
+        }
+        break;
+    }
+    default:
+        return; // Unknown types are ignored
+    }
+
+    if (on_message_) on_message_(session.id, message); // Views into the session's buffer, no copy
+}
+
+void ClientPool::dropSession(Loop& loop, Session& session)
+{
+    SessionState previous = session.state.load();
+    if (previous == SessionState::Closed) return;
+
+    bool closing;
+    {
+        std::lock_guard<std::mutex> lock(session.mutex);
+        if (session.fd != -1)
+        {
+            epoll_ctl(loop.epoll_fd, EPOLL_CTL_DEL, session.fd, nullptr);
+            ::close(session.fd);
+            session.fd = -1;
+        }
+        session.outbox.clear(); // A partly written frame can't be resumed on a new connection
+        session.written = 0;
+        session.session_id = 0; // The next connection does its own handshake
+        closing = session.closing;
+        session.state = (closing || !options_.reconnect) ? SessionState::Closed : SessionState::Waiting;
+    }
+    session.decoder.reset();
+
+    if (previous == SessionState::Connected)
+    {
+        connected_--;
+        if (on_state_) on_state_(session.id, false);
+    }
+
+    if (session.state.load() == SessionState::Closed)
+    {
+        open_--;
+        return;
+    }
+
+    reconnects_++;
+    loop.retries.emplace(std::chrono::steady_clock::now() + session.backoff, &session);
+    session.backoff = std::min(session.backoff * 2, options_.maxReconnectDelay);
+}
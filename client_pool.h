@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "client.h"
+
+// Many client sessions on a few event-loop threads. Every session is a non-blocking socket
+// owned by one loop (session id modulo loop count), so 10k sessions cost 10k sockets and
+// a handful of threads instead of 10k receive threads. Sends may come from any thread:
+// they append to the session's outbox and write as much as the socket takes right away,
+// the owning loop finishes the rest on EPOLLOUT. A session that loses its connection
+// reconnects with exponential backoff and rejoins its rooms. Named sessions do the Hello
+// handshake; the name table each server announces is kept once per server, not per session.
+
+using SessionId = uint32_t;
+constexpr SessionId INVALID_SESSION = UINT32_MAX; // open() could not resolve the host
+
+struct PoolOptions
+{
+    size_t threads = 1; // Event-loop threads
+    bool reconnect = true; // Reconnect sessions that lose their connection
+    std::chrono::milliseconds reconnectDelay{100}; // First retry delay, doubled after every failure
+    std::chrono::milliseconds maxReconnectDelay{5000}; // Retry delay cap
+    size_t maxOutboxBytes = 1024 * 1024; // Per session: sends fail while this much is unsent
+};
+
+struct PoolStats
+{
+    size_t sessions; // Open sessions (not closed by the user)
+    size_t connected; // Sessions with an established connection
+    uint64_t connects; // Connections established, first ones included
+    uint64_t reconnects; // Reconnect attempts scheduled
+};
+
+using SessionMessageHandler = std::function<void(SessionId, const ClientMessage&)>; // Runs on the session's loop
+using SessionStateHandler = std::function<void(SessionId, bool connected)>; // Runs on the session's loop
+
+class ClientPool {
+public:
+    explicit ClientPool(const PoolOptions& options = PoolOptions()); // Constructor
+    ~ClientPool(); // Destructor, stops the loops and closes every session
+
+    void setMessageHandler(SessionMessageHandler handler); // Call before start()
+    void setStateHandler(SessionStateHandler handler); // Call before start()
+    void start(); // Launch the event loops
+    void stop(); // Join the loops and close every socket
+
+    SessionId open(const std::string& host, int port, const std::string& name = ""); // Connects in the background
+    void close(SessionId id); // Disconnect for good (no reconnect)
+    bool isConnected(SessionId id) const;
+
+    bool sendMessage(SessionId id, const std::string& message); // Same frames as Client::sendMessage()
+    bool joinRoom(SessionId id, const std::string& room); // Remembered and rejoined after a reconnect
+    bool leaveRoom(SessionId id, const std::string& room);
+    bool sendToRoom(SessionId id, const std::string& room, const std::string& message);
+    bool sendDirect(SessionId id, const std::string& to, const std::string& message); // Once the session's handshake is done
+
+    PoolStats stats() const;
+
+private:
+    struct Session;
+    struct Loop;
+    struct NameMap;
+
+    Session* find(SessionId id) const; // nullptr for unknown ids
+    bool queueFrame(Session& session, FrameType type, std::initializer_list<std::string_view> parts); // Caller holds the session's mutex
+    bool flush(Session& session); // Caller holds the session's mutex. False on a socket error
+    void post(Loop& loop, Session* session); // Ask the loop to connect or close the session
+    void runLoop(Loop& loop);
+    void connectSession(Loop& loop, Session& session);
+    void handleEvent(Loop& loop, Session& session, uint32_t events);
+    void readSession(Session& session, bool& failed);
+    void dispatch(Session& session, const FrameView& frame); // Act on one received frame (loop thread)
+    bool queueMessage(Session& session, uint32_t room, const std::string& message); // Caller holds the session's mutex
+    size_t encodeHeader(Session& session, char* out, uint32_t room); // Next MessageHeader of the session (its mutex held)
+    void dropSession(Loop& loop, Session& session); // Close the socket, then reconnect or retire
+
+    PoolOptions options_;
+    SessionMessageHandler on_message_;
+    SessionStateHandler on_state_;
+    std::vector<std::unique_ptr<Loop>> loops_;
+    mutable std::shared_mutex sessions_mutex_; // Guards the sessions_ vector, not the sessions
+    std::vector<std::unique_ptr<Session>> sessions_; // Indexed by SessionId, never shrinks
+    std::unordered_map<std::string, std::shared_ptr<NameMap>> name_maps_; // By server address (sessions_mutex_)
+    std::atomic<bool> running_{false};
+    std::atomic<size_t> open_{0};
+    std::atomic<size_t> connected_{0};
+    std::atomic<uint64_t> connects_{0};
+    std::atomic<uint64_t> reconnects_{0};
+};
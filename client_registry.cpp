@@ -0,0 +1,92 @@
+#include "client_registry.h"
+#include "metrics.h"
+#include <thread>
+
+ClientRegistry::ClientRegistry()
+{
+    for (auto& segment : segments_) segment.store(nullptr, std::memory_order_relaxed);
+    readers_[0].store(0, std::memory_order_relaxed);
+    readers_[1].store(0, std::memory_order_relaxed);
+}
+
+ClientRegistry::~ClientRegistry()
+{
+    for (auto& segment : segments_) delete[] segment.load(std::memory_order_relaxed);
+}
+
+ClientRegistry::ReadGuard::ReadGuard(const ClientRegistry& registry) : registry_(registry)
+{
+    parity_ = static_cast<unsigned>(registry_.epoch_.load() & 1);
+    registry_.readers_[parity_].fetch_add(1); // seq_cst: ordered before every slot load below
+}
+
+ClientRegistry::ReadGuard::~ReadGuard()
+{
+    registry_.readers_[parity_].fetch_sub(1, std::memory_order_release);
+}
+
+Connection* ClientRegistry::at(uint32_t slot) const
+{
+    if (slot >= high_water_.load(std::memory_order_acquire)) return nullptr;
+    std::atomic<Connection*>* slots = segments_[slot / SEGMENT_SIZE].load(std::memory_order_acquire);
+    return slots[slot % SEGMENT_SIZE].load(std::memory_order_acquire);
+}
+
+uint32_t ClientRegistry::add(Connection* conn)
+{
+    uint64_t begin = metrics::nowNs();
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    metrics::record(Histogram::RegistryWait, metrics::nowNs() - begin);
+
+    uint32_t slot;
+    if (!free_slots_.empty())
+    {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+    }
+    else
+    {
+        slot = high_water_.load(std::memory_order_relaxed);
+        if (slot >= SEGMENT_SIZE * MAX_SEGMENTS) return NO_SLOT;
+
+        uint32_t seg = slot / SEGMENT_SIZE;
+        if (segments_[seg].load(std::memory_order_relaxed) == nullptr)
+        {
+            auto* slots = new std::atomic<Connection*>[SEGMENT_SIZE];
+            for (uint32_t i = 0; i < SEGMENT_SIZE; ++i) slots[i].store(nullptr, std::memory_order_relaxed);
+            segments_[seg].store(slots, std::memory_order_release);
+        }
+        high_water_.store(slot + 1, std::memory_order_release);
+    }
+
+    segments_[slot / SEGMENT_SIZE].load(std::memory_order_relaxed)[slot % SEGMENT_SIZE].store(conn, std::memory_order_release);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    return slot;
+}
+
+void ClientRegistry::remove(uint32_t slot)
+{
+    if (slot == NO_SLOT) return;
+    uint64_t begin = metrics::nowNs();
+    std::lock_guard<std::mutex> lock(write_mutex_);
+
+    segments_[slot / SEGMENT_SIZE].load(std::memory_order_relaxed)[slot % SEGMENT_SIZE].store(nullptr); // seq_cst
+    count_.fetch_sub(1, std::memory_order_relaxed);
+    synchronize(); // A reader that could have loaded the pointer is gone after this
+    free_slots_.push_back(slot);
+    metrics::record(Histogram::RegistryWait, metrics::nowNs() - begin); // Lock wait + grace period
+}
+
+void ClientRegistry::synchronize()
+{
+    // Readers that registered under the old parity may still hold the pointer; readers
+    // arriving after the flip register under the new parity and can't see the cleared slot.
+    uint64_t old = epoch_.fetch_add(1);
+    unsigned parity = static_cast<unsigned>(old & 1);
+    while (readers_[parity].load() != 0) std::this_thread::yield();
+
+    // Second flip so the next synchronize() waits on a parity no pre-existing reader uses
+    old = epoch_.fetch_add(1);
+    parity = static_cast<unsigned>(old & 1);
+    while (readers_[parity].load() != 0) std::this_thread::yield();
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+struct Connection;
+
+// Read-mostly set of live connections. Broadcasters iterate it without taking any lock:
+// connections sit in fixed slots inside segments that never move once published, and a
+// removed connection is only handed back to its owner after every reader that might still
+// see it has left its read section (two-epoch quiescence, as in userspace RCU).
+// Joins and leaves reuse free slots, so both are O(1) amortized; only they serialize on
+// write_mutex_.
+
+class ClientRegistry {
+public:
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+    ClientRegistry(); // Constructor
+    ~ClientRegistry(); // Destructor, frees the slot segments (not the connections)
+
+    uint32_t add(Connection* conn); // Publish a connection, returns its slot
+    void remove(uint32_t slot); // Unpublish, returns once no reader can still hold the pointer
+    size_t size() const { return count_.load(std::memory_order_relaxed); } // Live connections
+
+    class ReadGuard { // Read-side critical section, pointers read inside stay valid until it ends
+    public:
+        explicit ReadGuard(const ClientRegistry& registry);
+        ~ReadGuard();
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+    private:
+        const ClientRegistry& registry_;
+        unsigned parity_; // Epoch counter this reader registered with
+    };
+
+    Connection* at(uint32_t slot) const; // Connection in a slot or nullptr, call inside a ReadGuard
+
+    template <typename F>
+    void forEach(F&& fn) const // Visit every live connection without locking
+    {
+        ReadGuard guard(*this);
+        uint32_t end = high_water_.load(std::memory_order_acquire);
+        for (uint32_t seg = 0; seg * SEGMENT_SIZE < end; ++seg)
+        {
+            std::atomic<Connection*>* slots = segments_[seg].load(std::memory_order_acquire);
+            uint32_t limit = end - seg * SEGMENT_SIZE < SEGMENT_SIZE ? end - seg * SEGMENT_SIZE : SEGMENT_SIZE;
+            for (uint32_t i = 0; i < limit; ++i)
+            {
+                Connection* conn = slots[i].load(std::memory_order_acquire);
+                if (conn != nullptr) fn(*conn);
+            }
+        }
+    }
+
+private:
+    static constexpr uint32_t SEGMENT_SIZE = 1024; // Slots per segment
+    static constexpr uint32_t MAX_SEGMENTS = 1024; // Up to ~1M simultaneous connections
+
+    void synchronize(); // Wait for every reader that started before the call (write_mutex_ held)
+
+    std::atomic<std::atomic<Connection*>*> segments_[MAX_SEGMENTS]; // Published slot arrays
+    std::atomic<uint32_t> high_water_{0}; // Slots ever handed out, readers scan [0, high_water_)
+    std::atomic<size_t> count_{0}; // Occupied slots
+
+    mutable std::atomic<uint64_t> epoch_{0}; // Incremented by every synchronize()
+    mutable std::atomic<int64_t> readers_[2]; // Active readers per epoch parity
+
+    std::mutex write_mutex_; // Serializes joins and leaves, never taken by readers
+    std::vector<uint32_t> free_slots_; // Slots released by remove(), reused LIFO
+};
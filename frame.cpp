@@ -0,0 +1,193 @@
+#include "frame.h"
+#include <cstring>
+
+void encodeFrameHeader(char* out, FrameType type, size_t payloadLen)
+{
+    uint32_t len = static_cast<uint32_t>(payloadLen);
+    out[0] = static_cast<char>((len >> 24) & 0xFF);
+    out[1] = static_cast<char>((len >> 16) & 0xFF);
+    out[2] = static_cast<char>((len >> 8) & 0xFF);
+    out[3] = static_cast<char>(len & 0xFF);
+    out[4] = static_cast<char>(type);
+}
+
+void appendFrame(std::string& out, FrameType type, std::string_view payload)
+{
+    char header[FRAME_HEADER_SIZE];
+    encodeFrameHeader(header, type, payload.size());
+    out.append(header, FRAME_HEADER_SIZE);
+    out.append(payload.data(), payload.size());
+}
+
+std::string encodeFrame(FrameType type, std::string_view payload)
+{
+    std::string out;
+    out.reserve(FRAME_HEADER_SIZE + payload.size());
+    appendFrame(out, type, payload);
+    return out;
+}
+
+std::string encodeRoomFrame(std::string_view room, std::string_view text)
+{
+    std::string out;
+    out.reserve(FRAME_HEADER_SIZE + 1 + room.size() + text.size());
+    out.resize(FRAME_HEADER_SIZE);
+    encodeFrameHeader(&out[0], FrameType::RoomChat, 1 + room.size() + text.size());
+    out.push_back(static_cast<char>(room.size()));
+    out.append(room.data(), room.size());
+    out.append(text.data(), text.size());
+    return out;
+}
+
+bool parseRoomPayload(std::string_view payload, std::string_view& room, std::string_view& text)
+{
+    if (payload.empty()) return false;
+
+    size_t roomLen = static_cast<uint8_t>(payload[0]);
+    if (roomLen == 0 || 1 + roomLen > payload.size()) return false;
+
+    room = payload.substr(1, roomLen);
+    text = payload.substr(1 + roomLen);
+    return true;
+}
+
+size_t putVarint(char* out, uint64_t value)
+{
+    size_t n = 0;
+    while (value >= 0x80)
+    {
+        out[n++] = static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out[n++] = static_cast<char>(value);
+    return n;
+}
+
+bool getVarint(std::string_view& in, uint64_t& value)
+{
+    value = 0;
+    for (size_t i = 0; i < in.size() && i < MAX_VARINT_SIZE; ++i)
+    {
+        uint8_t byte = static_cast<uint8_t>(in[i]);
+        value |= static_cast<uint64_t>(byte & 0x7F) << (7 * i);
+        if ((byte & 0x80) == 0)
+        {
+            in.remove_prefix(i + 1);
+            return true;
+        }
+    }
+    return false; // Truncated or longer than a uint64_t
+}
+
+size_t encodeMessageHeader(char* out, const MessageHeader& header)
+{
+    size_t n = putVarint(out, header.sender);
+    n += putVarint(out + n, header.room);
+    n += putVarint(out + n, header.sequence);
+    n += putVarint(out + n, header.timestamp);
+    return n;
+}
+
+bool parseMessagePayload(std::string_view payload, MessageHeader& header, std::string_view& text)
+{
+    uint64_t sender, room;
+    if (!getVarint(payload, sender) || !getVarint(payload, room) || !getVarint(payload, header.sequence) ||
+        !getVarint(payload, header.timestamp) || sender > UINT32_MAX || room > UINT32_MAX)
+        return false;
+
+    header.sender = static_cast<uint32_t>(sender);
+    header.room = static_cast<uint32_t>(room);
+    text = payload;
+    return true;
+}
+
+bool parseDirectPayload(std::string_view payload, std::string_view& to, MessageHeader& header, std::string_view& text)
+{
+    if (payload.empty()) return false;
+
+    size_t toLen = static_cast<uint8_t>(payload[0]);
+    if (toLen == 0 || 1 + toLen > payload.size()) return false;
+
+    to = payload.substr(1, toLen);
+    return parseMessagePayload(payload.substr(1 + toLen), header, text);
+}
+
+void appendNameEntry(std::string& payload, NameKind kind, uint32_t id, std::string_view name)
+{
+    char buf[1 + 2 * MAX_VARINT_SIZE];
+    buf[0] = static_cast<char>(kind);
+    size_t n = 1 + putVarint(buf + 1, id);
+    n += putVarint(buf + n, name.size());
+    payload.append(buf, n);
+    payload.append(name.data(), name.size());
+}
+
+bool nextNameEntry(std::string_view& payload, NameKind& kind, uint32_t& id, std::string_view& name)
+{
+    if (payload.empty()) return false;
+    kind = static_cast<NameKind>(payload[0]);
+    payload.remove_prefix(1);
+
+    uint64_t value, length;
+    if (!getVarint(payload, value) || !getVarint(payload, length) || value > UINT32_MAX || length > payload.size()) return false;
+    id = static_cast<uint32_t>(value);
+    name = payload.substr(0, length);
+    payload.remove_prefix(length);
+    return true;
+}
+
+FrameDecoder::FrameDecoder(size_t initialCapacity) : buf_(initialCapacity) {} // Constructor
+
+char* FrameDecoder::writePtr(size_t minSpace)
+{
+    if (head_ == tail_) // Everything consumed, restart at the front
+    {
+        head_ = 0;
+        tail_ = 0;
+    }
+
+    if (buf_.size() - tail_ < minSpace && head_ > 0) // Only a partial frame is left: move it to the front
+    {
+        std::memmove(buf_.data(), buf_.data() + head_, tail_ - head_);
+        tail_ -= head_;
+        head_ = 0;
+    }
+
+    if (buf_.size() - tail_ < minSpace) buf_.resize(tail_ + minSpace);
+    return buf_.data() + tail_;
+}
+
+size_t FrameDecoder::writable() const { return buf_.size() - tail_; }
+
+void FrameDecoder::commit(size_t n) { tail_ += n; }
+
+FrameDecoder::Status FrameDecoder::next(FrameView& frame)
+{
+    size_t available = tail_ - head_;
+    if (available < FRAME_HEADER_SIZE) return Status::NeedMore;
+
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(buf_.data() + head_);
+    uint32_t len = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+    if (len > MAX_FRAME_PAYLOAD) return Status::Error;
+    if (available < FRAME_HEADER_SIZE + len) return Status::NeedMore;
+
+    const char* start = buf_.data() + head_;
+    frame.type = static_cast<FrameType>(p[4]);
+    frame.payload = std::string_view(start + FRAME_HEADER_SIZE, len);
+    frame.wire = std::string_view(start, FRAME_HEADER_SIZE + len);
+    head_ += FRAME_HEADER_SIZE + len;
+    return Status::Frame;
+}
+
+void FrameDecoder::putBack(const FrameView& frame)
+{
+    head_ -= frame.wire.size(); // The bytes are still in place until the next writePtr()
+}
+
+size_t FrameDecoder::buffered() const { return tail_ - head_; }
+
+void FrameDecoder::reset()
+{
+    head_ = 0;
+    tail_ = 0;
+}
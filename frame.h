@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "slab_pool.h"
+
+// Wire format shared by Server and Client:
+//   [u32 payload length, big-endian][u8 frame type][payload bytes]
+// TCP may split or merge writes, so receivers run every read through a FrameDecoder.
+//
+// Session handshake: a named client sends Hello once, the server answers Welcome with a numeric
+// session id and from then on the client sends Message frames whose compact varint header
+// identifies the sender instead of a "name: " text prefix. Clients learn the id-to-name table
+// from Name frames: a snapshot on connect, then one entry per user joining or leaving.
+//
+// Heartbeats: a side that has heard nothing from its peer for a while sends a Ping, and the
+// peer answers with a Pong. Any frame counts as a sign of life, so busy connections never ping.
+
+enum class FrameType : uint8_t
+{
+    Chat = 0, // Text line to broadcast
+    Join = 1, // Payload is a room name to subscribe to
+    Leave = 2, // Payload is a room name to unsubscribe from
+    RoomChat = 3, // Room message: [u8 room length][room name][text], forwarded to the room's members
+    Hello = 4, // Client -> server: nickname, sent once right after connecting
+    Welcome = 5, // Server -> client: [varint session id][varint server epoch, ms since 1970]
+    Name = 6, // Server -> client: name table entries, see appendNameEntry()
+    Message = 7, // Compact chat: MessageHeader (four varints) followed by the text
+    Direct = 8, // Direct message: [u8 recipient length][recipient nickname][MessageHeader][text], handshaken senders only
+    Ping = 9, // Either direction: liveness probe, answered with a Pong carrying the same payload
+    Pong = 10 // Reply to a Ping
+};
+
+enum class NameKind : uint8_t
+{
+    User = 0, // Session id -> nickname, an empty name retires the id
+    Room = 1 // Room id -> room name, sent to a handshaken client when it joins
+};
+
+struct MessageHeader // Leading fields of a Message payload
+{
+    uint32_t sender = 0; // Session id from Welcome, checked by the server
+    uint32_t room = 0; // Room id from a Name entry, 0 for everyone
+    uint64_t sequence = 0; // Per-sender counter
+    uint64_t timestamp = 0; // Sender's clock, ms since the server epoch in Welcome
+};
+
+constexpr size_t FRAME_HEADER_SIZE = 5; // Length prefix + type byte
+constexpr size_t MAX_FRAME_PAYLOAD = 64 * 1024; // Larger frames are treated as a protocol error
+constexpr size_t MAX_ROOM_NAME = 255; // Room names travel with a one byte length
+constexpr size_t MAX_NICKNAME = 255; // Longer Hello frames are ignored
+constexpr size_t MAX_VARINT_SIZE = 10; // LEB128 bytes of a uint64_t
+constexpr size_t MAX_MESSAGE_HEADER = 4 * MAX_VARINT_SIZE; // Upper bound of an encoded MessageHeader
+
+struct FrameView // Non-owning view of one complete frame inside a receive buffer
+{
+    FrameType type; // Frame type from the header
+    std::string_view payload; // Payload bytes
+    std::string_view wire; // Header + payload, can be forwarded verbatim
+};
+
+void encodeFrameHeader(char* out, FrameType type, size_t payloadLen); // Write FRAME_HEADER_SIZE bytes to out
+void appendFrame(std::string& out, FrameType type, std::string_view payload); // Append a whole frame to out
+std::string encodeFrame(FrameType type, std::string_view payload); // Return a whole frame
+std::string encodeRoomFrame(std::string_view room, std::string_view text); // Return a whole RoomChat frame
+bool parseRoomPayload(std::string_view payload, std::string_view& room, std::string_view& text); // Split a RoomChat payload
+
+size_t putVarint(char* out, uint64_t value); // LEB128, returns bytes written (at most MAX_VARINT_SIZE)
+bool getVarint(std::string_view& in, uint64_t& value); // Consume one varint from the front of in
+size_t encodeMessageHeader(char* out, const MessageHeader& header); // Returns bytes written
+bool parseMessagePayload(std::string_view payload, MessageHeader& header, std::string_view& text); // Split a Message payload
+bool parseDirectPayload(std::string_view payload, std::string_view& to, MessageHeader& header, std::string_view& text); // Split a Direct payload
+void appendNameEntry(std::string& payload, NameKind kind, uint32_t id, std::string_view name); // [u8 kind][varint id][varint length][name]
+bool nextNameEntry(std::string_view& payload, NameKind& kind, uint32_t& id, std::string_view& name); // Consume one entry
+
+class FrameDecoder { // Streaming decoder: handles partial reads and several frames per read
+public:
+    enum class Status { Frame, NeedMore, Error };
+
+    explicit FrameDecoder(size_t initialCapacity = 4096); // Constructor
+
+    char* writePtr(size_t minSpace = 4096); // Free space to recv() into, invalidates previous views
+    size_t writable() const; // Bytes available at writePtr()
+    void commit(size_t n); // Mark n bytes written at writePtr() as received
+    Status next(FrameView& frame); // Extract the next complete frame, views stay valid until writePtr()
+    void putBack(const FrameView& frame); // Undo the last next(): the frame comes out again (no writePtr() in between)
+    size_t buffered() const; // Received bytes not yet returned as frames
+    void reset(); // Drop everything buffered (e.g. on reconnect)
+
+private:
+    std::vector<char, SlabAllocator<char>> buf_; // Receive buffer, grows to fit the largest frame seen, pooled across connections
+    size_t head_ = 0; // Start of the first unconsumed byte
+    size_t tail_ = 0; // End of the received bytes
+};
@@ -0,0 +1,13 @@
+#include "history_ring.h"
+
+HistoryRing::HistoryRing(size_t capacity) : slots_(capacity) {} // Constructor
+
+void HistoryRing::push(const SharedMessage& message)
+{
+    if (slots_.empty()) return;
+
+    slots_[next_] = message; // Releases the evicted message's reference
+    next_ = (next_ + 1) % slots_.size();
+    if (count_ < slots_.size()) ++count_;
+    ++total_;
+}
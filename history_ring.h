@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "message_buffer.h"
+
+// The last N broadcast messages, kept as the same framed buffers that were sent to the
+// room. A joining client gets them queued by reference and written in one scatter-gather
+// call, so a reconnect storm costs neither re-serialization nor a disk read.
+// Not thread-safe: each epoll shard owns one, threaded mode guards its ring with a mutex.
+
+class HistoryRing {
+public:
+    explicit HistoryRing(size_t capacity); // Constructor, capacity 0 disables history
+
+    void push(const SharedMessage& message); // Append, evicting the oldest entry when full
+    size_t size() const { return count_; } // Messages held
+    size_t capacity() const { return slots_.size(); }
+    uint64_t total() const { return total_; } // Messages ever pushed
+
+    template <typename F>
+    void forEach(F&& fn) const // Oldest to newest
+    {
+        size_t start = (next_ + slots_.size() - count_) % (slots_.empty() ? 1 : slots_.size());
+        for (size_t i = 0; i < count_; ++i) fn(slots_[(start + i) % slots_.size()]);
+    }
+
+private:
+    std::vector<SharedMessage> slots_; // Ring storage
+    size_t next_ = 0; // Slot the next push writes
+    size_t count_ = 0; // Occupied slots
+    uint64_t total_ = 0; // Pushes since construction
+};
@@ -0,0 +1,68 @@
+#include "message_log.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+// Sustained append rate of MessageLog for each fsync policy.
+// Usage: log_bench [directory] [messages] [payload bytes] [batch size]
+
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char* argv[])
+{
+    std::string directory = argc > 1 ? argv[1] : "/tmp/chat_log_bench";
+    size_t messages = argc > 2 ? std::stoul(argv[2]) : 200000;
+    size_t payload = argc > 3 ? std::stoul(argv[3]) : 128;
+    size_t batchSize = argc > 4 ? std::stoul(argv[4]) : 64;
+
+    std::vector<SharedMessage> batch;
+    for (size_t i = 0; i < batchSize; ++i)
+    {
+        std::string frame(payload, 'x');
+        batch.push_back(SharedMessage::create(frame, 0, -1));
+    }
+
+    std::cout << "=== Message Log Benchmark (" << messages << " x " << payload << " B, batches of " << batchSize << ") ===" << std::endl;
+
+    struct Policy { const char* name; FsyncPolicy fsync; };
+    for (Policy policy : {Policy{"never", FsyncPolicy::Never}, Policy{"interval", FsyncPolicy::Interval},
+                          Policy{"batch", FsyncPolicy::EveryBatch}})
+    {
+        std::string dir = directory + "-" + policy.name;
+        std::string cleanup = "rm -rf '" + dir + "'";
+        if (std::system(cleanup.c_str()) != 0) return 1;
+
+        MessageLogOptions options;
+        options.directory = dir;
+        options.fsync = policy.fsync;
+        MessageLog log(options);
+        if (!log.open())
+        {
+            std::cerr << "✗ Can't open log in " << dir << std::endl;
+            return 1;
+        }
+
+        auto begin = Clock::now();
+        for (size_t done = 0; done < messages; done += batchSize)
+        {
+            log.appendBatch(batch.data(), std::min(batchSize, messages - done));
+        }
+        log.close();
+        double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+
+        MessageLogStats stats = log.stats();
+        double rate = stats.appended / seconds;
+        double mbps = stats.bytes / seconds / (1024 * 1024);
+        std::cout << std::left << std::setw(10) << policy.name << std::fixed << std::setprecision(0) << rate
+                  << " msgs/s  " << std::setprecision(1) << mbps << " MB/s  " << stats.syncs << " syncs, "
+                  << stats.segments << " segment(s)" << std::endl;
+        std::cout << "RESULT fsync=" << policy.name << " msgs_per_sec=" << std::setprecision(0) << rate
+                  << " mb_per_sec=" << std::setprecision(1) << mbps << std::endl;
+
+        if (std::system(cleanup.c_str()) != 0) return 1;
+    }
+    return 0;
+}
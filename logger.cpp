@@ -0,0 +1,235 @@
+#include "logger.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+std::atomic<uint8_t> logger::min_level{static_cast<uint8_t>(LogLevel::Info)};
+
+namespace
+{
+    constexpr size_t BATCH_BYTES = 64 * 1024; // Output assembled per write
+
+    struct LogRecord
+    {
+        LogLevel level;
+        uint16_t length;
+        char text[LOG_RECORD_TEXT];
+    };
+
+    struct LogRing // One producer (the owning thread), one consumer (the logger thread)
+    {
+        explicit LogRing(size_t capacity) : records(capacity), mask(capacity - 1) {}
+
+        std::vector<LogRecord> records;
+        size_t mask;
+        alignas(64) std::atomic<size_t> tail{0}; // Next record the producer writes
+        alignas(64) std::atomic<size_t> head{0}; // Next record the consumer reads
+        std::atomic<bool> retired{false}; // Owner exited: freed by the consumer once drained
+        LogRing* next = nullptr; // Intrusive list of rings (Logger::mutex)
+    };
+
+    struct Logger
+    {
+        std::mutex mutex; // Ring list, consumer sleep and flush handshakes
+        std::condition_variable wake_cv; // Consumer waits here when every ring is empty
+        std::condition_variable flushed_cv; // flush() waits here
+        LogRing* rings = nullptr;
+        std::thread consumer;
+        std::atomic<bool> sleeping{false};
+        std::atomic<uint64_t> flush_requests{0};
+        uint64_t flushes_done = 0;
+        std::atomic<uint32_t> sample_every{1};
+        size_t ring_capacity = 1024;
+        std::atomic<uint64_t> written{0};
+        std::atomic<uint64_t> dropped{0};
+
+        void consumeLoop();
+        size_t drain(std::string& out, std::string& err); // Copy queued records out up to the buffers' capacity, free finished rings
+        bool anyQueued(); // Caller holds mutex
+    };
+
+    Logger& instance()
+    {
+        static Logger* logger = []()
+        {
+            Logger* l = new Logger(); // Never destroyed: detached threads may log during exit
+            l->consumer = std::thread(&Logger::consumeLoop, l);
+            l->consumer.detach();
+            std::atexit([]() { logger::flush(); }); // Nothing logged before exit() is lost
+            return l;
+        }();
+        return *logger;
+    }
+
+    struct RingOwner // Retires the calling thread's ring when the thread exits
+    {
+        LogRing* ring = nullptr;
+        ~RingOwner()
+        {
+            if (ring != nullptr) ring->retired.store(true, std::memory_order_release);
+        }
+    };
+
+    thread_local RingOwner owner;
+    thread_local uint32_t sample_counter = 0;
+
+    LogRing& localRing()
+    {
+        if (owner.ring == nullptr)
+        {
+            Logger& logger = instance();
+            std::lock_guard<std::mutex> lock(logger.mutex);
+            size_t capacity = 1;
+            while (capacity < logger.ring_capacity) capacity <<= 1;
+            owner.ring = new LogRing(capacity);
+            owner.ring->next = logger.rings;
+            logger.rings = owner.ring;
+        }
+        return *owner.ring;
+    }
+
+    void writeOut(const std::string& text, FILE* stream)
+    {
+        if (text.empty()) return;
+        std::fwrite(text.data(), 1, text.size(), stream);
+        std::fflush(stream);
+    }
+}
+
+bool Logger::anyQueued()
+{
+    for (LogRing* r = rings; r != nullptr; r = r->next)
+    {
+        if (r->head.load(std::memory_order_relaxed) != r->tail.load(std::memory_order_acquire)) return true;
+    }
+    return false;
+}
+
+size_t Logger::drain(std::string& out, std::string& err)
+{
+    std::lock_guard<std::mutex> lock(mutex); // Producers only take it to register a ring
+    size_t count = 0;
+
+    for (LogRing** link = &rings; *link != nullptr;)
+    {
+        LogRing* r = *link;
+        size_t head = r->head.load(std::memory_order_relaxed);
+        size_t tail = r->tail.load(std::memory_order_acquire);
+        for (; head != tail; ++head, ++count)
+        {
+            const LogRecord& record = r->records[head & r->mask];
+            std::string& target = record.level == LogLevel::Error ? err : out;
+            if (target.size() + record.length + 1 > target.capacity()) break; // Batch full, the rest goes in the next one
+            target.append(record.text, record.length).push_back('\n');
+        }
+        r->head.store(head, std::memory_order_release);
+
+        if (r->retired.load(std::memory_order_acquire) && r->tail.load(std::memory_order_acquire) == head)
+        {
+            *link = r->next; // Owner is gone and nothing is left
+            delete r;
+            continue;
+        }
+        link = &r->next;
+    }
+    return count;
+}
+
+void Logger::consumeLoop()
+{
+    std::string out, err;
+    out.reserve(BATCH_BYTES); // Reused for every batch, never grows
+    err.reserve(BATCH_BYTES);
+    while (true)
+    {
+        uint64_t requested = flush_requests.load(std::memory_order_acquire);
+        size_t count = drain(out, err);
+        writeOut(out, stdout); // One write per batch instead of one flushed write per line
+        writeOut(err, stderr);
+        out.clear();
+        err.clear();
+        written.fetch_add(count, std::memory_order_relaxed);
+        if (count > 0) continue;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if (flushes_done < requested) // Every ring was empty after the request: it is done
+        {
+            flushes_done = requested;
+            flushed_cv.notify_all();
+        }
+
+        sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst); // A producer after this fence sees sleeping
+        wake_cv.wait(lock, [this]() { return flush_requests.load() > flushes_done || anyQueued(); });
+        sleeping.store(false, std::memory_order_relaxed);
+    }
+}
+
+void logger::configure(const LogOptions& options)
+{
+    Logger& logger = instance();
+    {
+        std::lock_guard<std::mutex> lock(logger.mutex);
+        logger.ring_capacity = options.ringCapacity < 2 ? 2 : options.ringCapacity; // Rings created from now on
+    }
+    logger.sample_every.store(options.sampleEvery, std::memory_order_relaxed);
+    min_level.store(static_cast<uint8_t>(options.level), std::memory_order_relaxed);
+}
+
+void logger::write(LogLevel level, std::string_view prefix, std::string_view text)
+{
+    LogRing& ring = localRing();
+    Logger& logger = instance();
+
+    size_t tail = ring.tail.load(std::memory_order_relaxed);
+    if (tail - ring.head.load(std::memory_order_acquire) > ring.mask) // Full: never wait on the logger
+    {
+        logger.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    LogRecord& record = ring.records[tail & ring.mask];
+    size_t p = std::min(prefix.size(), LOG_RECORD_TEXT);
+    size_t t = std::min(text.size(), LOG_RECORD_TEXT - p);
+    std::memcpy(record.text, prefix.data(), p);
+    std::memcpy(record.text + p, text.data(), t);
+    record.length = static_cast<uint16_t>(p + t);
+    record.level = level;
+    ring.tail.store(tail + 1, std::memory_order_release);
+
+    std::atomic_thread_fence(std::memory_order_seq_cst); // Pairs with the consumer's fence before it sleeps
+    if (logger.sleeping.load(std::memory_order_relaxed))
+    {
+        std::lock_guard<std::mutex> lock(logger.mutex);
+        logger.wake_cv.notify_one();
+    }
+}
+
+void logger::sample(LogLevel level, std::string_view prefix, std::string_view text)
+{
+    if (!enabled(level)) return;
+    uint32_t every = instance().sample_every.load(std::memory_order_relaxed);
+    if (every == 0 || sample_counter++ % every != 0) return;
+    write(level, prefix, text);
+}
+
+void logger::flush()
+{
+    Logger& logger = instance();
+    std::unique_lock<std::mutex> lock(logger.mutex);
+    uint64_t target = logger.flush_requests.fetch_add(1) + 1;
+    logger.wake_cv.notify_one();
+    logger.flushed_cv.wait(lock, [&]() { return logger.flushes_done >= target; });
+}
+
+LoggerStats logger::stats()
+{
+    Logger& logger = instance();
+    return LoggerStats{logger.written.load(std::memory_order_relaxed), logger.dropped.load(std::memory_order_relaxed)};
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Asynchronous logger. A logging thread copies its line into a fixed-size record in its own
+// single-producer/single-consumer ring (no lock, no allocation, no syscall) and moves on; one
+// background thread drains every ring, assembles the lines and writes them in batches. A full
+// ring drops the record and counts it rather than stalling the caller. Records are
+// truncated to LOG_RECORD_TEXT bytes.
+
+enum class LogLevel : uint8_t
+{
+    Debug,
+    Info,
+    Warn,
+    Error, // Written to stderr, the other levels to stdout
+    Off
+};
+
+struct LogOptions
+{
+    LogLevel level = LogLevel::Info; // Records below this level are discarded at the call site
+    uint32_t sampleEvery = 1; // logger::sample() keeps 1 call in N per thread, 0 discards them all
+    size_t ringCapacity = 1024; // Records per thread ring, rounded up to a power of two
+};
+
+struct LoggerStats
+{
+    uint64_t written; // Records written out
+    uint64_t dropped; // Records lost to a full ring
+};
+
+constexpr size_t LOG_RECORD_TEXT = 240; // Line bytes kept per record
+
+namespace logger
+{
+    extern std::atomic<uint8_t> min_level; // Cached LogOptions::level for enabled()
+
+    void configure(const LogOptions& options); // Call before logging starts; level and sampling may change later
+    inline bool enabled(LogLevel level) { return static_cast<uint8_t>(level) >= min_level.load(std::memory_order_relaxed); }
+
+    void write(LogLevel level, std::string_view prefix, std::string_view text = {}); // One line: prefix + text
+    void sample(LogLevel level, std::string_view prefix, std::string_view text = {}); // Like write(), rate-limited by sampleEvery
+    void flush(); // Block until every record logged before the call has been written
+    LoggerStats stats();
+
+    inline void debug(std::string_view prefix, std::string_view text = {}) { if (enabled(LogLevel::Debug)) write(LogLevel::Debug, prefix, text); }
+    inline void info(std::string_view prefix, std::string_view text = {}) { if (enabled(LogLevel::Info)) write(LogLevel::Info, prefix, text); }
+    inline void warn(std::string_view prefix, std::string_view text = {}) { if (enabled(LogLevel::Warn)) write(LogLevel::Warn, prefix, text); }
+    inline void error(std::string_view prefix, std::string_view text = {}) { if (enabled(LogLevel::Error)) write(LogLevel::Error, prefix, text); }
+}
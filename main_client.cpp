@@ -32,7 +32,10 @@ int main()
         std::getline(std::cin, name);
     }
 
-    Client client(host_str, port, name);
+    ClientOptions options;
+    options.heartbeat = std::chrono::seconds(30); // Notice a dead server instead of waiting forever
+    options.idleTimeout = std::chrono::seconds(90);
+    Client client(host_str, port, name, options);
     if (!client.connectToServer()) 
     {
         std::cerr << "✗ Unable to connect to " << host_str << ":" << port << std::endl;
@@ -42,6 +45,7 @@ int main()
     {
         std::cout << "✓ Connected as '" << name << "'. Type messages and press Enter to send" << std::endl;
         std::cout << "Hint: Type 'quit' + Enter to disconnect and exit." << std::endl;
+        std::cout << "Hint: '/join ROOM', '/leave ROOM' and '/room ROOM MESSAGE' for rooms, '/dm NAME MESSAGE' for a direct message." << std::endl;
     }
 
     std::string line;
@@ -65,6 +69,31 @@ int main()
             break;
         }
 
+        if (line.rfind("/join ", 0) == 0 || line.rfind("/leave ", 0) == 0) 
+        {
+            bool join = line[1] == 'j';
+            std::string room = line.substr(join ? 6 : 7);
+            if (!(join ? client.joinRoom(room) : client.leaveRoom(room)))
+                std::cerr << "✗ Invalid room or connection closed" << std::endl;
+            continue;
+        }
+
+        if (line.rfind("/room ", 0) == 0) 
+        {
+            size_t space = line.find(' ', 6);
+            if (space == std::string::npos || !client.sendToRoom(line.substr(6, space - 6), line.substr(space + 1)))
+                std::cerr << "✗ Usage: /room ROOM MESSAGE" << std::endl;
+            continue;
+        }
+
+        if (line.rfind("/dm ", 0) == 0) 
+        {
+            size_t space = line.find(' ', 4);
+            if (space == std::string::npos || !client.sendDirect(line.substr(4, space - 4), line.substr(space + 1)))
+                std::cerr << "✗ Usage: /dm NAME MESSAGE" << std::endl;
+            continue;
+        }
+
         if (!client.sendMessage(line)) 
         {
             std::cerr << "✗ Failed to send (connection may be closed)" << std::endl;
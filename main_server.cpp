@@ -1,7 +1,109 @@
 #include <iostream>
-#include <thread>
-#include <chrono>
+#include <string>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <signal.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
 #include "server.h"
+#include "logger.h"
+
+// Apply one "--key=value" option to the server or logger configuration. Returns false if it is unknown or invalid.
+bool parseOption(const std::string& arg, ServerOptions& options, LogOptions& logOptions)
+{
+    size_t eq = arg.find('=');
+    if (arg.rfind("--", 0) != 0 || eq == std::string::npos) return false;
+
+    std::string key = arg.substr(2, eq - 2);
+    std::string value = arg.substr(eq + 1);
+
+    try
+    {
+        if (key == "mode")
+        {
+            if (value == "threaded") options.mode = ServerMode::Threaded;
+            else if (value == "epoll") options.mode = ServerMode::Epoll;
+            else if (value == "uring") options.mode = ServerMode::Uring;
+            else return false;
+        }
+        else if (key == "shards")
+        {
+            options.shards = std::stoi(value);
+            if (options.shards < 1) return false;
+        }
+        else if (key == "workers")
+        {
+            options.workers = std::stoul(value);
+            if (options.workers < 1) return false;
+        }
+        else if (key == "high-watermark") options.outbound.highWatermark = std::stoul(value);
+        else if (key == "low-watermark") options.outbound.lowWatermark = std::stoul(value);
+        else if (key == "archive-capacity") options.archive.capacity = std::stoul(value);
+        else if (key == "archive-overflow")
+        {
+            if (value == "drop") options.archive.overflow = ArchiveOverflow::DropNewest;
+            else if (value == "block") options.archive.overflow = ArchiveOverflow::Block;
+            else return false;
+        }
+        else if (key == "log-dir") options.log.directory = value;
+        else if (key == "log-segment-size") options.log.segmentSize = std::stoul(value);
+        else if (key == "fsync")
+        {
+            if (value == "never") options.log.fsync = FsyncPolicy::Never;
+            else if (value == "batch") options.log.fsync = FsyncPolicy::EveryBatch;
+            else if (value == "interval") options.log.fsync = FsyncPolicy::Interval;
+            else return false;
+        }
+        else if (key == "fsync-interval-ms") options.log.fsyncIntervalMs = std::stoi(value);
+        else if (key == "history") options.history = std::stoul(value);
+        else if (key == "max-rooms") options.maxRooms = std::stoul(value);
+        else if (key == "admin-port") options.adminPort = std::stoi(value);
+        else if (key == "log-level")
+        {
+            if (value == "debug") logOptions.level = LogLevel::Debug;
+            else if (value == "info") logOptions.level = LogLevel::Info;
+            else if (value == "warn") logOptions.level = LogLevel::Warn;
+            else if (value == "error") logOptions.level = LogLevel::Error;
+            else if (value == "off") logOptions.level = LogLevel::Off;
+            else return false;
+        }
+        else if (key == "log-sample") logOptions.sampleEvery = std::stoul(value);
+        else if (key == "rate-client-msgs") options.limits.clientMessages = std::stod(value);
+        else if (key == "rate-client-bytes") options.limits.clientBytes = std::stod(value);
+        else if (key == "rate-room-msgs") options.limits.roomMessages = std::stod(value);
+        else if (key == "rate-room-bytes") options.limits.roomBytes = std::stod(value);
+        else if (key == "rate-burst")
+        {
+            options.limits.burst = std::stod(value);
+            if (options.limits.burst <= 0) return false;
+        }
+        else if (key == "rate-penalty-ms") options.limits.penaltyMs = std::stoul(value);
+        else if (key == "heartbeat-ms") options.heartbeatMs = std::stoul(value);
+        else if (key == "idle-timeout-ms") options.idleTimeoutMs = std::stoul(value);
+        else if (key == "read-quantum")
+        {
+            options.readQuantum = std::stoul(value);
+            if (options.readQuantum == 0) return false;
+        }
+        else if (key == "slow-policy")
+        {
+            if (value == "drop-oldest") options.outbound.policy = SlowConsumerPolicy::DropOldest;
+            else if (value == "drop-newest") options.outbound.policy = SlowConsumerPolicy::DropNewest;
+            else if (value == "disconnect") options.outbound.policy = SlowConsumerPolicy::Disconnect;
+            else return false;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+    return true;
+}
 
 int main(int argc, char* argv[]) 
 {
@@ -9,21 +111,67 @@ int main(int argc, char* argv[])
     if (argc < 2) 
     {
         std::cerr << "✗ Invalid arguments" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " <port> [--mode=threaded|epoll|uring] [--shards=N] [--workers=N]"
+                  << " [--high-watermark=BYTES] [--low-watermark=BYTES]"
+                  << " [--slow-policy=drop-oldest|drop-newest|disconnect]"
+                  << " [--archive-capacity=N] [--archive-overflow=drop|block]"
+                  << " [--log-dir=PATH] [--log-segment-size=BYTES] [--fsync=never|batch|interval]"
+                  << " [--fsync-interval-ms=N] [--history=N] [--max-rooms=N] [--admin-port=N]"
+                  << " [--log-level=debug|info|warn|error|off] [--log-sample=N]"
+                  << " [--rate-client-msgs=N] [--rate-client-bytes=N] [--rate-room-msgs=N] [--rate-room-bytes=N]"
+                  << " [--rate-burst=SECONDS] [--rate-penalty-ms=N]"
+                  << " [--heartbeat-ms=N (default 30000)] [--idle-timeout-ms=N (default 90000), 0 disables]"
+                  << " [--read-quantum=BYTES]" << std::endl;
         return 1;
     }
 
     int port = std::stoi(argv[1]);
 
-    Server server(port);
-    std::thread serverThread([&server]() { server.start(); });
-    std::this_thread::sleep_for(std::chrono::seconds(1));
+    ServerOptions options;
+    options.heartbeatMs = 30000; // Dead peers (half-open connections) are dropped unless turned off
+    options.idleTimeoutMs = 90000;
+    LogOptions logOptions;
+    for (int i = 2; i < argc; ++i)
+    {
+        if (!parseOption(argv[i], options, logOptions))
+        {
+            std::cerr << "✗ Invalid option '" << argv[i] << "'" << std::endl;
+            return 1;
+        }
+    }
 
-    while (server.running) 
+    if (options.outbound.lowWatermark > options.outbound.highWatermark)
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds(200)); // Main thread sleeps to reduce CPU usage
+        std::cerr << "✗ --low-watermark must not exceed --high-watermark" << std::endl;
+        return 1;
+    }
+
+    sigset_t signals; // SIGINT/SIGTERM are read from a signalfd, so block them before any thread inherits the mask
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    int signal_fd = signalfd(-1, &signals, SFD_CLOEXEC);
+    if (signal_fd == -1)
+    {
+        std::cerr << "✗ Can't create signalfd: " << strerror(errno) << std::endl;
+        return 1;
     }
 
+    logger::configure(logOptions);
+    Server server(port, options);
+    server.start(); // Returns once the server accepts connections
+    if (!server.running)
+    {
+        close(signal_fd);
+        return 1;
+    }
+
+    signalfd_siginfo info{};
+    while (read(signal_fd, &info, sizeof(info)) == -1 && errno == EINTR) {} // Sleeps until SIGINT or SIGTERM (docker stop)
+    logger::info("🛑 Stopping on ", strsignal(static_cast<int>(info.ssi_signo)));
+
     server.stop();
-    if (serverThread.joinable()) serverThread.join();
+    close(signal_fd);
     return 0;
 }
@@ -0,0 +1,83 @@
+#include "message_buffer.h"
+#include "metrics.h"
+#include "slab_pool.h"
+#include <cstring>
+#include <new>
+#include <utility>
+
+SharedMessage::SharedMessage(const SharedMessage& other) : buf_(other.buf_)
+{
+    if (buf_ != nullptr) buf_->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+SharedMessage::SharedMessage(SharedMessage&& other) noexcept : buf_(other.buf_)
+{
+    other.buf_ = nullptr;
+}
+
+SharedMessage& SharedMessage::operator=(const SharedMessage& other)
+{
+    if (this != &other)
+    {
+        if (other.buf_ != nullptr) other.buf_->refs.fetch_add(1, std::memory_order_relaxed);
+        release();
+        buf_ = other.buf_;
+    }
+    return *this;
+}
+
+SharedMessage& SharedMessage::operator=(SharedMessage&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        buf_ = other.buf_;
+        other.buf_ = nullptr;
+    }
+    return *this;
+}
+
+SharedMessage::~SharedMessage()
+{
+    release();
+}
+
+SharedMessage SharedMessage::create(std::string_view wire, size_t payloadOffset, int senderSock)
+{
+    return create({wire}, payloadOffset, senderSock);
+}
+
+SharedMessage SharedMessage::create(std::initializer_list<std::string_view> parts, size_t payloadOffset, int senderSock)
+{
+    size_t size = 0;
+    for (std::string_view part : parts) size += part.size();
+
+    void* mem = slab::allocate(sizeof(MessageBuffer) + size); // Header and bytes in one pooled block
+    MessageBuffer* buf = new (mem) MessageBuffer;
+    buf->refs.store(1, std::memory_order_relaxed);
+    buf->size = static_cast<uint32_t>(size);
+    buf->payloadOffset = static_cast<uint32_t>(payloadOffset);
+    buf->senderSock = senderSock;
+    buf->sequence = 0;
+    buf->receivedNs = metrics::nowNs(); // One clock read per message, not per recipient
+
+    char* out = reinterpret_cast<char*>(buf + 1);
+    for (std::string_view part : parts)
+    {
+        std::memcpy(out, part.data(), part.size());
+        out += part.size();
+    }
+    return SharedMessage(buf);
+}
+
+void SharedMessage::release()
+{
+    if (buf_ == nullptr) return;
+    if (buf_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) // Last reference
+    {
+        size_t bytes = sizeof(MessageBuffer) + buf_->size;
+        buf_->~MessageBuffer();
+        slab::release(buf_, bytes); // Back to this thread's free list
+    }
+    buf_ = nullptr;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string_view>
+
+// A received message is stored exactly once: header and wire bytes live in a single
+// allocation that is never modified after creation. Recipients' outbound queues, shard
+// inboxes and the archive queue only hold SharedMessage handles (one pointer each), so a
+// broadcast costs O(1) payload memory no matter how many clients it reaches.
+
+struct MessageBuffer // Immutable, refcounted block: this header followed by the frame bytes
+{
+    std::atomic<uint32_t> refs; // Handles pointing at this block
+    uint32_t size; // Frame bytes (header + payload)
+    uint32_t payloadOffset; // Payload position inside the frame
+    int senderSock; // Socket the message was received from
+    uint64_t sequence; // Server-wide order given when entering the history ring, 0 if never
+    uint64_t receivedNs; // Arrival time (metrics::nowNs()), for recv-to-send latency
+
+    const char* bytes() const { return reinterpret_cast<const char*>(this + 1); }
+};
+
+class SharedMessage { // Intrusive refcounted handle to a MessageBuffer
+public:
+    SharedMessage() = default;
+    SharedMessage(const SharedMessage& other); // Shares the buffer (refcount + 1)
+    SharedMessage(SharedMessage&& other) noexcept; // Takes over the reference
+    SharedMessage& operator=(const SharedMessage& other);
+    SharedMessage& operator=(SharedMessage&& other) noexcept;
+    ~SharedMessage(); // Frees the buffer with the last reference
+
+    static SharedMessage create(std::string_view wire, size_t payloadOffset, int senderSock); // Copy a frame once
+    static SharedMessage create(std::initializer_list<std::string_view> parts, size_t payloadOffset, int senderSock); // Concatenate into one block
+
+    const char* data() const { return buf_->bytes(); } // Frame bytes, ready to send
+    size_t size() const { return buf_->size; } // Frame length
+    std::string_view wire() const { return std::string_view(buf_->bytes(), buf_->size); }
+    std::string_view payload() const
+    {
+        return std::string_view(buf_->bytes() + buf_->payloadOffset, buf_->size - buf_->payloadOffset);
+    }
+    int senderSock() const { return buf_->senderSock; }
+    uint64_t sequence() const { return buf_->sequence; }
+    uint64_t receivedNs() const { return buf_->receivedNs; }
+    void setSequence(uint64_t sequence) { buf_->sequence = sequence; } // Only before the message is shared
+    uint32_t useCount() const { return buf_ ? buf_->refs.load(std::memory_order_relaxed) : 0; }
+    explicit operator bool() const { return buf_ != nullptr; }
+
+private:
+    explicit SharedMessage(MessageBuffer* buf) : buf_(buf) {}
+    void release(); // Drop this handle's reference
+
+    MessageBuffer* buf_ = nullptr; // Shared block, nullptr for an empty handle
+};
@@ -0,0 +1,317 @@
+#include "message_log.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <iostream>
+
+namespace
+{
+    struct Crc32cTable
+    {
+        uint32_t entries[256];
+
+        Crc32cTable()
+        {
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                uint32_t crc = i;
+                for (int bit = 0; bit < 8; ++bit) crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1u)));
+                entries[i] = crc;
+            }
+        }
+    };
+
+    const Crc32cTable CRC_TABLE;
+
+    void putU32(char* p, uint32_t v) { std::memcpy(p, &v, sizeof(v)); } // Host order, the log is not portable
+    void putU64(char* p, uint64_t v) { std::memcpy(p, &v, sizeof(v)); }
+    uint32_t getU32(const char* p) { uint32_t v; std::memcpy(&v, p, sizeof(v)); return v; }
+    uint64_t getU64(const char* p) { uint64_t v; std::memcpy(&v, p, sizeof(v)); return v; }
+
+    int64_t steadyMs()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Checksum covers sequence, timestamp and frame bytes
+    uint32_t recordCrc(const char* record, uint32_t recordSize)
+    {
+        return crc32c(record + 8, recordSize - 8);
+    }
+
+    // Walk valid records of a mapped segment. Returns the end offset of the last valid one.
+    size_t scanSegment(const char* base, size_t size, const std::function<void(const LogRecord&)>* fn, uint64_t* lastSeq)
+    {
+        size_t offset = 0;
+        while (offset + MessageLog::RECORD_HEADER_SIZE <= size)
+        {
+            const char* rec = base + offset;
+            uint32_t recordSize = getU32(rec);
+            if (recordSize < MessageLog::RECORD_HEADER_SIZE || recordSize > size - offset) break; // End or torn
+            if (getU32(rec + 4) != recordCrc(rec, recordSize)) break; // Torn write
+
+            uint64_t seq = getU64(rec + 8);
+            if (lastSeq != nullptr) *lastSeq = seq;
+            if (fn != nullptr)
+            {
+                LogRecord record{seq, getU64(rec + 16),
+                                 std::string_view(rec + MessageLog::RECORD_HEADER_SIZE, recordSize - MessageLog::RECORD_HEADER_SIZE)};
+                (*fn)(record);
+            }
+            offset += recordSize;
+        }
+        return offset;
+    }
+}
+
+uint32_t crc32c(const void* data, size_t len, uint32_t crc)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    crc = ~crc;
+    while (len--) crc = CRC_TABLE.entries[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+MessageLog::MessageLog(const MessageLogOptions& options) : options_(options) {} // Constructor
+
+MessageLog::~MessageLog()
+{
+    close();
+}
+
+std::string MessageLog::segmentPath(uint64_t firstSeq) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%020llu.seg", static_cast<unsigned long long>(firstSeq));
+    return options_.directory + "/" + name;
+}
+
+std::vector<std::string> MessageLog::listSegments() const
+{
+    std::vector<std::string> names;
+    DIR* dir = opendir(options_.directory.c_str());
+    if (dir == nullptr) return names;
+
+    while (dirent* entry = readdir(dir))
+    {
+        std::string name = entry->d_name;
+        if (name.size() == 24 && name.compare(20, 4, ".seg") == 0) names.push_back(name);
+    }
+    closedir(dir);
+
+    std::sort(names.begin(), names.end()); // Zero-padded, so lexical order is sequence order
+    for (std::string& name : names) name = options_.directory + "/" + name;
+    return names;
+}
+
+bool MessageLog::open()
+{
+    if (options_.directory.empty()) return false;
+    if (mkdir(options_.directory.c_str(), 0755) == -1 && errno != EEXIST)
+    {
+        std::cerr << "✗ Can't create log directory " << options_.directory << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    stats_ = MessageLogStats{};
+    std::vector<std::string> segments = listSegments();
+
+    if (segments.empty())
+    {
+        next_seq_ = 1;
+        if (!openSegment(segmentPath(next_seq_), true)) return false;
+        stats_.segments++;
+    }
+    else
+    {
+        if (!openSegment(segments.back(), false)) return false;
+        const std::string& last = segments.back();
+        offset_ = recover(std::stoull(last.substr(last.size() - 24, 20))); // Name holds the first sequence
+    }
+
+    synced_ = offset_;
+    last_sync_ms_ = steadyMs();
+    return true;
+}
+
+bool MessageLog::openSegment(const std::string& path, bool create)
+{
+    int flags = O_RDWR | O_CLOEXEC | (create ? O_CREAT | O_EXCL : 0);
+    int fd = ::open(path.c_str(), flags, 0644);
+    if (fd == -1)
+    {
+        std::cerr << "✗ Can't open log segment " << path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat st;
+    fstat(fd, &st);
+    size_t size = create ? options_.segmentSize : static_cast<size_t>(st.st_size);
+
+    if (create && posix_fallocate(fd, 0, static_cast<off_t>(size)) != 0) // Reserve blocks up front
+    {
+        if (ftruncate(fd, static_cast<off_t>(size)) == -1)
+        {
+            ::close(fd);
+            return false;
+        }
+    }
+
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED)
+    {
+        std::cerr << "✗ Can't map log segment " << path << ": " << strerror(errno) << std::endl;
+        ::close(fd);
+        return false;
+    }
+    madvise(base, size, MADV_SEQUENTIAL);
+
+    fd_ = fd;
+    base_ = static_cast<char*>(base);
+    size_ = size;
+    offset_ = 0;
+    return true;
+}
+
+size_t MessageLog::recover(uint64_t firstSeq)
+{
+    uint64_t lastSeq = 0;
+    size_t end = scanSegment(base_, size_, nullptr, &lastSeq);
+
+    const char* tail = base_ + end; // Anything non-zero past the last valid record is a torn write
+    size_t dirty = size_ - end;
+    while (dirty > 0 && tail[dirty - 1] == 0) --dirty;
+    if (dirty > 0)
+    {
+        std::memset(base_ + end, 0, dirty);
+        msync(base_, size_, MS_SYNC);
+        stats_.truncated = dirty;
+    }
+
+    next_seq_ = lastSeq > 0 ? lastSeq + 1 : firstSeq;
+    stats_.recovered = lastSeq > 0 ? lastSeq - firstSeq + 1 : 0;
+    return end;
+}
+
+void MessageLog::closeSegment()
+{
+    if (base_ != nullptr) munmap(base_, size_);
+    if (fd_ != -1) ::close(fd_);
+    base_ = nullptr;
+    fd_ = -1;
+    size_ = 0;
+    offset_ = 0;
+    synced_ = 0;
+}
+
+void MessageLog::close()
+{
+    if (base_ == nullptr) return;
+    sync();
+    closeSegment();
+}
+
+bool MessageLog::rollSegment()
+{
+    sync();
+    closeSegment();
+    if (!openSegment(segmentPath(next_seq_), true)) return false;
+    stats_.segments++;
+    return true;
+}
+
+bool MessageLog::sync()
+{
+    if (base_ == nullptr) return false;
+    if (synced_ == offset_) return true;
+
+    long page = sysconf(_SC_PAGESIZE);
+    size_t from = synced_ & ~static_cast<size_t>(page - 1); // msync() wants a page-aligned start
+    if (msync(base_ + from, offset_ - from, MS_SYNC) == -1) return false;
+
+    synced_ = offset_;
+    last_sync_ms_ = steadyMs();
+    stats_.syncs++;
+    return true;
+}
+
+bool MessageLog::appendBatch(const SharedMessage* batch, size_t count)
+{
+    if (base_ == nullptr) return false;
+
+    uint64_t now = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint32_t recordSize = static_cast<uint32_t>(RECORD_HEADER_SIZE + batch[i].size());
+        if (recordSize > options_.segmentSize) // Can never fit, skip rather than loop forever
+        {
+            stats_.oversized++;
+            continue;
+        }
+        if (offset_ + recordSize > size_ && !rollSegment()) return false;
+
+        char* rec = base_ + offset_;
+        putU64(rec + 8, next_seq_);
+        putU64(rec + 16, now);
+        std::memcpy(rec + RECORD_HEADER_SIZE, batch[i].data(), batch[i].size());
+        putU32(rec + 4, recordCrc(rec, recordSize));
+        putU32(rec, recordSize); // Size last: a crash before this leaves a clean end marker
+
+        offset_ += recordSize;
+        next_seq_++;
+        stats_.appended++;
+        stats_.bytes += recordSize;
+    }
+
+    if (options_.fsync == FsyncPolicy::EveryBatch) return sync(); // Group commit: one sync per batch
+    if (options_.fsync == FsyncPolicy::Interval && steadyMs() - last_sync_ms_ >= options_.fsyncIntervalMs) return sync();
+    return true;
+}
+
+int MessageLog::syncDue()
+{
+    if (options_.fsync != FsyncPolicy::Interval || base_ == nullptr || synced_ == offset_) return -1;
+
+    int64_t left = options_.fsyncIntervalMs - (steadyMs() - last_sync_ms_);
+    if (left > 0) return static_cast<int>(left);
+    sync();
+    return -1;
+}
+
+size_t MessageLog::replay(const std::function<void(const LogRecord&)>& fn) const
+{
+    size_t total = 0;
+    for (const std::string& path : listSegments())
+    {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) continue;
+
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void* base = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+            if (base != MAP_FAILED)
+            {
+                std::function<void(const LogRecord&)> counting = [&](const LogRecord& record)
+                {
+                    ++total;
+                    fn(record);
+                };
+                scanSegment(static_cast<const char*>(base), static_cast<size_t>(st.st_size), &counting, nullptr);
+                munmap(base, static_cast<size_t>(st.st_size));
+            }
+        }
+        ::close(fd);
+    }
+    return total;
+}
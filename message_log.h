@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "message_buffer.h"
+
+// Persistent chat history: an append-only log split into fixed-size segment files.
+// Segments are preallocated and mmap'd, so appending a record is a memcpy into the
+// mapping; durability is a separate step (group commit) governed by FsyncPolicy.
+//
+// Segment file: <directory>/<first sequence, 20 digits>.seg, zero-filled to segmentSize.
+// Record:       [u32 record size][u32 crc32c][u64 sequence][u64 unix time ns][frame bytes]
+// A zero record size marks the end of the written part. On open() the last segment is
+// scanned and everything after the last record with a valid checksum (a torn tail from a
+// crash mid-write) is zeroed again.
+
+enum class FsyncPolicy
+{
+    Never,     // Leave write-back to the kernel
+    EveryBatch, // msync() after every appended batch
+    Interval   // msync() at most once per fsyncIntervalMs, and no later (syncDue() covers a lull)
+};
+
+struct MessageLogOptions
+{
+    std::string directory; // Where segment files live, empty disables persistence
+    size_t segmentSize = 64 * 1024 * 1024; // Bytes preallocated per segment
+    FsyncPolicy fsync = FsyncPolicy::Interval; // Group-commit durability policy
+    int fsyncIntervalMs = 100; // Interval policy: maximum time between syncs
+};
+
+struct LogRecord // View of one record, valid during the replay callback only
+{
+    uint64_t sequence; // Position in the log, starts at 1
+    uint64_t timestampNs; // Append time (system clock)
+    std::string_view frame; // Frame bytes as broadcast
+};
+
+struct MessageLogStats
+{
+    uint64_t appended; // Records written since open()
+    uint64_t bytes; // Record bytes written since open()
+    uint64_t syncs; // msync() calls
+    uint64_t segments; // Segments created since open()
+    uint64_t recovered; // Valid records found in the last segment by open()
+    uint64_t truncated; // Torn-tail bytes zeroed by open()
+    uint64_t oversized; // Records larger than a segment, never written
+};
+
+class MessageLog {
+public:
+    static constexpr size_t RECORD_HEADER_SIZE = 24;
+
+    explicit MessageLog(const MessageLogOptions& options); // Constructor
+    ~MessageLog(); // Destructor, syncs and unmaps
+
+    bool open(); // Create the directory if needed, recover the last segment. False on I/O error
+    void close(); // Sync and unmap the current segment
+
+    bool appendBatch(const SharedMessage* batch, size_t count); // Append, then sync per policy (single writer)
+    bool sync(); // Force the written part of the current segment to disk
+    int syncDue(); // Interval policy: sync a tail whose interval has passed. Ms until the rest is due, -1 if nothing waits
+
+    size_t replay(const std::function<void(const LogRecord&)>& fn) const; // Visit every record on disk in order
+    uint64_t nextSequence() const { return next_seq_; }
+    MessageLogStats stats() const { return stats_; }
+
+private:
+    std::string segmentPath(uint64_t firstSeq) const; // File name for a segment
+    std::vector<std::string> listSegments() const; // Segment paths sorted by first sequence
+    bool openSegment(const std::string& path, bool create); // Map a segment as the current one
+    bool rollSegment(); // Sync and close the current segment, start a new one at next_seq_
+    void closeSegment(); // Unmap and close the current segment
+    size_t recover(uint64_t firstSeq); // Scan the current segment, zero a torn tail, returns the valid end offset
+
+    MessageLogOptions options_;
+    int fd_ = -1; // Current segment file
+    char* base_ = nullptr; // Mapping of the current segment
+    size_t size_ = 0; // Mapping length
+    size_t offset_ = 0; // End of the written records
+    size_t synced_ = 0; // End of the part known to be on disk
+    uint64_t next_seq_ = 1; // Sequence of the next record
+    int64_t last_sync_ms_ = 0; // Steady-clock time of the last sync
+    MessageLogStats stats_{};
+};
+
+uint32_t crc32c(const void* data, size_t len, uint32_t crc = 0); // Castagnoli CRC (software, table-driven)
@@ -0,0 +1,252 @@
+#include "metrics.h"
+#include <mutex>
+#include <sstream>
+#include <cstring>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+namespace
+{
+    const char* COUNTER_NAMES[] = {
+        "chat_connections_accepted_total",
+        "chat_connections_closed_total",
+        "chat_bytes_in_total",
+        "chat_bytes_out_total",
+        "chat_frames_in_total",
+        "chat_messages_broadcast_total",
+        "chat_deliveries_total",
+        "chat_outbound_drops_total",
+        "chat_slow_disconnects_total",
+        "chat_direct_messages_total",
+        "chat_direct_undeliverable_total",
+        "chat_throttled_total",
+        "chat_pings_sent_total",
+        "chat_idle_evictions_total",
+        "chat_log_oversized_total",
+    };
+    static_assert(sizeof(COUNTER_NAMES) / sizeof(COUNTER_NAMES[0]) == size_t(Counter::COUNT), "one name per counter");
+
+    const char* HISTOGRAM_NAMES[] = {
+        "chat_recv_to_send_ns",
+        "chat_registry_wait_ns",
+    };
+    static_assert(sizeof(HISTOGRAM_NAMES) / sizeof(HISTOGRAM_NAMES[0]) == size_t(Histogram::COUNT), "one name per histogram");
+
+    struct HistogramTotals
+    {
+        std::array<uint64_t, LatencyHistogram::BUCKETS> buckets{};
+        uint64_t count = 0;
+        uint64_t sum = 0;
+    };
+
+    struct Registry // Live blocks plus the totals of blocks whose thread has exited
+    {
+        std::mutex mutex; // Registration, retirement and snapshots only, never the hot path
+        MetricsBlock* live = nullptr;
+        std::array<uint64_t, size_t(Counter::COUNT)> retiredCounters{};
+        std::array<HistogramTotals, size_t(Histogram::COUNT)> retiredHistograms;
+    };
+
+    Registry& registry()
+    {
+        static Registry* instance = new Registry(); // Never destroyed: threads may retire during exit
+        return *instance;
+    }
+
+    void collect(const MetricsBlock& block, std::array<uint64_t, size_t(Counter::COUNT)>& counters,
+                 std::array<HistogramTotals, size_t(Histogram::COUNT)>& histograms)
+    {
+        for (size_t i = 0; i < counters.size(); ++i) counters[i] += block.counters[i].load(std::memory_order_relaxed);
+        for (size_t i = 0; i < histograms.size(); ++i)
+            block.histograms[i].mergeInto(histograms[i].buckets, histograms[i].count, histograms[i].sum);
+    }
+
+    struct LocalBlock // Owns the calling thread's block and folds it into the totals at thread exit
+    {
+        MetricsBlock* block = nullptr;
+
+        ~LocalBlock()
+        {
+            if (block == nullptr) return;
+            metrics::local_block = nullptr;
+            Registry& reg = registry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            collect(*block, reg.retiredCounters, reg.retiredHistograms);
+            for (MetricsBlock** p = &reg.live; *p != nullptr; p = &(*p)->next)
+            {
+                if (*p == block) { *p = block->next; break; }
+            }
+            delete block;
+        }
+    };
+
+    thread_local LocalBlock owner;
+
+    uint64_t percentile(const HistogramTotals& h, double p)
+    {
+        if (h.count == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(p * (h.count - 1));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < h.buckets.size(); ++i)
+        {
+            seen += h.buckets[i];
+            if (seen > rank) return LatencyHistogram::upperBound(i);
+        }
+        return 0;
+    }
+}
+
+size_t LatencyHistogram::index(uint64_t value)
+{
+    if (value < SUB) return static_cast<size_t>(value);
+    int e = 63 - __builtin_clzll(value); // Power of two the value falls under
+    return (e - SUB_BITS + 1) * SUB + ((value >> (e - SUB_BITS)) & (SUB - 1));
+}
+
+uint64_t LatencyHistogram::upperBound(size_t index)
+{
+    if (index < SUB) return index;
+    int e = static_cast<int>(index / SUB) + SUB_BITS - 1;
+    uint64_t width = uint64_t(1) << (e - SUB_BITS);
+    return ((SUB + index % SUB) << (e - SUB_BITS)) + width - 1;
+}
+
+void LatencyHistogram::mergeInto(std::array<uint64_t, BUCKETS>& buckets, uint64_t& count, uint64_t& sum) const
+{
+    for (size_t i = 0; i < BUCKETS; ++i) buckets[i] += buckets_[i].load(std::memory_order_relaxed);
+    count += count_.load(std::memory_order_relaxed);
+    sum += sum_.load(std::memory_order_relaxed);
+}
+
+MetricsBlock& metrics::registerThread()
+{
+    owner.block = new MetricsBlock();
+    {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        owner.block->next = reg.live;
+        reg.live = owner.block;
+    }
+    local_block = owner.block;
+    return *local_block;
+}
+
+uint64_t metrics::total(Counter c)
+{
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    uint64_t sum = reg.retiredCounters[size_t(c)];
+    for (MetricsBlock* b = reg.live; b != nullptr; b = b->next) sum += b->counters[size_t(c)].load(std::memory_order_relaxed);
+    return sum;
+}
+
+std::string metrics::snapshot()
+{
+    std::array<uint64_t, size_t(Counter::COUNT)> counters{};
+    std::array<HistogramTotals, size_t(Histogram::COUNT)> histograms;
+    {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        counters = reg.retiredCounters;
+        histograms = reg.retiredHistograms;
+        for (MetricsBlock* b = reg.live; b != nullptr; b = b->next) collect(*b, counters, histograms);
+    }
+
+    std::ostringstream out;
+    for (size_t i = 0; i < counters.size(); ++i) out << COUNTER_NAMES[i] << " " << counters[i] << "\n";
+    for (size_t i = 0; i < histograms.size(); ++i)
+    {
+        const HistogramTotals& h = histograms[i];
+        for (double q : {0.5, 0.9, 0.99, 0.999})
+            out << HISTOGRAM_NAMES[i] << "{quantile=\"" << q << "\"} " << percentile(h, q) << "\n";
+        out << HISTOGRAM_NAMES[i] << "_count " << h.count << "\n";
+        out << HISTOGRAM_NAMES[i] << "_sum " << h.sum << "\n";
+    }
+    return out.str();
+}
+
+AdminEndpoint::AdminEndpoint() {} // Constructor
+
+AdminEndpoint::~AdminEndpoint()
+{
+    stop();
+}
+
+bool AdminEndpoint::start(int port, Render render)
+{
+    listening_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listening_ == -1) return false;
+
+    int opt = 1;
+    setsockopt(listening_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr); // Local only: metrics are not for the chat port's audience
+
+    if (bind(listening_, (sockaddr*)&addr, sizeof(addr)) == -1 || listen(listening_, 16) == -1)
+    {
+        close(listening_);
+        listening_ = -1;
+        return false;
+    }
+
+    wake_fd_ = eventfd(0, EFD_CLOEXEC);
+    render_ = std::move(render);
+    thread_ = std::thread(&AdminEndpoint::serve, this);
+    return true;
+}
+
+void AdminEndpoint::stop()
+{
+    if (!thread_.joinable()) return;
+
+    uint64_t one = 1;
+    ssize_t ignored = write(wake_fd_, &one, sizeof(one));
+    (void)ignored;
+    thread_.join();
+
+    close(listening_);
+    close(wake_fd_);
+    listening_ = -1;
+    wake_fd_ = -1;
+}
+
+void AdminEndpoint::serve()
+{
+    while (true)
+    {
+        pollfd fds[2] = {{listening_, POLLIN, 0}, {wake_fd_, POLLIN, 0}};
+        if (poll(fds, 2, -1) == -1) continue; // EINTR
+        if (fds[1].revents != 0) return; // stop()
+
+        int client = accept4(listening_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client == -1) continue;
+
+        char request[512];
+        pollfd in = {client, POLLIN, 0};
+        ssize_t n = poll(&in, 1, 100) == 1 ? recv(client, request, sizeof(request), MSG_DONTWAIT) : 0; // nc sends nothing
+
+        std::string body = render_();
+        std::string response;
+        if (n >= 4 && std::memcmp(request, "GET ", 4) == 0) // curl / Prometheus
+        {
+            response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+        }
+        response += body;
+
+        size_t sent = 0;
+        while (sent < response.size())
+        {
+            ssize_t w = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+            if (w <= 0) break;
+            sent += static_cast<size_t>(w);
+        }
+        close(client);
+    }
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+
+// Process-wide counters and latency histograms. Every thread writes to its own cache-line
+// aligned block (registered on first use), with plain relaxed loads and stores: no locked
+// instruction and no shared cache line on the hot path. A snapshot sums the live blocks and
+// what exited threads left behind, so totals are exact once writers are quiet and at most a
+// few increments stale while they run.
+
+enum class Counter
+{
+    ConnectionsAccepted, // Clients accepted
+    ConnectionsClosed, // Clients removed
+    BytesIn, // Bytes received from clients
+    BytesOut, // Bytes written to clients
+    FramesIn, // Frames decoded from clients
+    MessagesBroadcast, // Chat and room messages fanned out
+    Deliveries, // Message references queued for a recipient
+    OutboundDrops, // Messages dropped by the slow-consumer policy
+    SlowDisconnects, // Clients dropped by the Disconnect policy
+    DirectMessages, // Direct messages routed to at least one connection of the recipient
+    DirectUndeliverable, // Direct messages to a nickname nobody holds
+    Throttled, // Times a client's reads were paused by a rate limit
+    PingsSent, // Pings sent to clients that had been silent for the heartbeat interval
+    IdleEvictions, // Clients disconnected after the idle timeout without a sign of life
+    LogOversized, // Messages too large for a log segment, archived but not persisted
+    COUNT
+};
+
+enum class Histogram
+{
+    RecvToSend, // Nanoseconds from a message's arrival to its first complete write to a recipient
+    RegistryWait, // Nanoseconds a join or leave spent waiting in ClientRegistry (lock + grace period)
+    COUNT
+};
+
+class LatencyHistogram { // HDR-style log-linear buckets: 16 per power of two, about 6% error
+public:
+    static constexpr int SUB_BITS = 4;
+    static constexpr size_t SUB = size_t(1) << SUB_BITS;
+    static constexpr size_t BUCKETS = (64 - SUB_BITS + 1) * SUB;
+
+    void record(uint64_t value) // Single writer
+    {
+        bump(buckets_[index(value)], 1);
+        bump(count_, 1);
+        bump(sum_, value);
+    }
+    void mergeInto(std::array<uint64_t, BUCKETS>& buckets, uint64_t& count, uint64_t& sum) const; // Any thread
+
+    static size_t index(uint64_t value);
+    static uint64_t upperBound(size_t index); // Largest value that falls in the bucket
+
+private:
+    static void bump(std::atomic<uint64_t>& a, uint64_t n) { a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+
+    std::array<std::atomic<uint64_t>, BUCKETS> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+};
+
+struct alignas(64) MetricsBlock // One thread's counters and histograms
+{
+    std::array<std::atomic<uint64_t>, size_t(Counter::COUNT)> counters{};
+    std::array<LatencyHistogram, size_t(Histogram::COUNT)> histograms;
+    MetricsBlock* next = nullptr; // Intrusive link in the list of live blocks
+};
+
+namespace metrics
+{
+    inline thread_local MetricsBlock* local_block = nullptr; // Cached so the hot path is one TLS load
+    MetricsBlock& registerThread(); // Slow path of local(): allocate and publish this thread's block
+
+    inline MetricsBlock& local() // Calling thread's block, registered on first use
+    {
+        return local_block != nullptr ? *local_block : registerThread();
+    }
+
+    inline void add(Counter c, uint64_t n = 1)
+    {
+        std::atomic<uint64_t>& slot = local().counters[size_t(c)];
+        slot.store(slot.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); // Only this thread writes it
+    }
+
+    inline void record(Histogram h, uint64_t ns) { local().histograms[size_t(h)].record(ns); }
+
+    inline uint64_t nowNs() // Monotonic clock for latency samples
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    uint64_t total(Counter c); // Sum over every thread, live and exited
+    std::string snapshot(); // Every counter and histogram as "name value" lines
+}
+
+class AdminEndpoint { // Serves a text snapshot to every connection on a local TCP port
+public:
+    using Render = std::function<std::string()>;
+
+    AdminEndpoint(); // Constructor
+    ~AdminEndpoint(); // Destructor, stops the endpoint
+
+    bool start(int port, Render render); // Bind 127.0.0.1:port and start serving
+    void stop(); // Close the listener and join the thread
+
+private:
+    void serve(); // Accept loop: one snapshot per connection, HTTP if the peer sent a GET
+
+    int listening_ = -1;
+    int wake_fd_ = -1; // Eventfd signalled by stop()
+    Render render_;
+    std::thread thread_;
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "message_buffer.h"
+
+// Bounded lock-free multi-producer/single-consumer ring of message references, after
+// Vyukov's bounded queue: every slot carries a sequence number, so a producer claims a
+// position with one CAS on the tail and publishes with one release store, and the consumer
+// never touches the tail. Header-only, shared by the server's Archive and Client's async
+// send queue.
+
+class MpscRing { // Bounded lock-free ring (per-slot sequence numbers), many producers, one consumer
+public:
+    explicit MpscRing(size_t capacity); // Constructor, capacity rounded up to a power of two
+
+    bool tryPush(const SharedMessage& message); // Any thread. False when full
+    size_t popBatch(SharedMessage* out, size_t max); // Consumer thread only. Moves up to max messages out
+    size_t size() const; // Approximate number of queued messages
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> sequence; // Position this slot is ready for (producer: pos, consumer: pos + 1)
+        SharedMessage message;
+    };
+
+    static size_t roundUpPow2(size_t n)
+    {
+        size_t p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> tail_{0}; // Next position to claim (producers)
+    alignas(64) std::atomic<size_t> head_{0}; // Next position to read (consumer)
+};
+
+inline MpscRing::MpscRing(size_t capacity) : mask_(roundUpPow2(capacity < 2 ? 2 : capacity) - 1)
+{
+    slots_.reset(new Slot[mask_ + 1]);
+    for (size_t i = 0; i <= mask_; ++i) slots_[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+inline bool MpscRing::tryPush(const SharedMessage& message)
+{
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    while (true)
+    {
+        Slot& slot = slots_[pos & mask_];
+        size_t seq = slot.sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+        if (diff == 0) // Slot free for this lap: claim the position
+        {
+            if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                slot.message = message;
+                slot.sequence.store(pos + 1, std::memory_order_release); // Publish to the consumer
+                return true;
+            }
+        }
+        else if (diff < 0) // Consumer hasn't freed it yet: full
+        {
+            return false;
+        }
+        else // Another producer took it, reload
+        {
+            pos = tail_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+inline size_t MpscRing::popBatch(SharedMessage* out, size_t max)
+{
+    size_t pos = head_.load(std::memory_order_relaxed);
+    size_t count = 0;
+
+    while (count < max)
+    {
+        Slot& slot = slots_[pos & mask_];
+        if (slot.sequence.load(std::memory_order_acquire) != pos + 1) break; // Not published yet
+
+        out[count++] = std::move(slot.message);
+        slot.sequence.store(pos + mask_ + 1, std::memory_order_release); // Free for the next lap
+        ++pos;
+    }
+
+    head_.store(pos, std::memory_order_relaxed);
+    return count;
+}
+
+inline size_t MpscRing::size() const
+{
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t head = head_.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+}
@@ -0,0 +1,65 @@
+#include "name_table.h"
+#include "frame.h"
+#include <mutex>
+
+uint32_t NameTable::addUser(std::string_view name)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    uint32_t id = next_user_++;
+    users_.emplace(id, std::string(name));
+    return id;
+}
+
+void NameTable::removeUser(uint32_t id)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    users_.erase(id);
+}
+
+size_t NameTable::users() const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return users_.size();
+}
+
+uint32_t NameTable::internRoom(std::string_view room)
+{
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_); // Common case: the room is known
+        auto it = room_ids_.find(std::string(room));
+        if (it != room_ids_.end()) return it->second;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (room_names_.size() >= max_rooms_) // Known names still resolve, new ones are refused
+    {
+        auto it = room_ids_.find(std::string(room));
+        return it != room_ids_.end() ? it->second : 0;
+    }
+    auto inserted = room_ids_.emplace(std::string(room), static_cast<uint32_t>(room_names_.size() + 1));
+    if (inserted.second) room_names_.emplace_back(room);
+    return inserted.first->second;
+}
+
+std::string_view NameTable::roomName(uint32_t id) const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    if (id == 0 || id > room_names_.size()) return std::string_view();
+    return room_names_[id - 1];
+}
+
+void NameTable::appendSnapshot(std::string& out) const
+{
+    std::string payload;
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    for (const auto& user : users_)
+    {
+        if (payload.size() + 1 + 2 * MAX_VARINT_SIZE + user.second.size() > MAX_FRAME_PAYLOAD) // Split across frames
+        {
+            appendFrame(out, FrameType::Name, payload);
+            payload.clear();
+        }
+        appendNameEntry(payload, NameKind::User, user.first, user.second);
+    }
+    if (!payload.empty()) appendFrame(out, FrameType::Name, payload);
+}
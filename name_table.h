@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Server-wide id-to-name table behind the session handshake. Each Hello gets the next session
+// id, so messages carry a small varint instead of the sender's name; rooms are interned to
+// ids the first time someone joins them and keep them for the server's lifetime, which lets
+// roomName() hand out views that stay valid. Since room names come from clients, the number
+// of rooms is capped (setMaxRooms()) and internRoom() refuses new names once it is reached.
+// Lookups take a shared lock, changes an exclusive one.
+
+class NameTable {
+public:
+    uint32_t addUser(std::string_view name); // New session id, never 0
+    void removeUser(uint32_t id);
+    size_t users() const;
+
+    void setMaxRooms(size_t rooms) { max_rooms_ = rooms; } // Call before the first internRoom()
+    uint32_t internRoom(std::string_view room); // Same id for the same name, 0 for a new name once the table is full
+    std::string_view roomName(uint32_t id) const; // Empty for unknown ids, valid as long as the table
+
+    void appendSnapshot(std::string& out) const; // Name frames listing every user, appended to out
+
+private:
+    mutable std::shared_mutex mutex_;
+    uint32_t next_user_ = 1; // Ids are not reused while the server runs
+    std::unordered_map<uint32_t, std::string> users_;
+    std::unordered_map<std::string, uint32_t> room_ids_;
+    std::deque<std::string> room_names_; // Room id - 1, a deque never moves its elements
+    size_t max_rooms_ = 65536; // At most 255 bytes each
+};
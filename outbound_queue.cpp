@@ -0,0 +1,134 @@
+#include "outbound_queue.h"
+#include "metrics.h"
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <cerrno>
+#include <algorithm>
+
+void OutboundQueue::account(size_t depth, size_t bytes)
+{
+    depth_.store(depth, std::memory_order_relaxed);
+    bytes_.store(bytes, std::memory_order_relaxed);
+}
+
+OutboundQueue::PushResult OutboundQueue::push(SharedMessage message, const OutboundLimits& limits)
+{
+    size_t queued = bytes();
+
+    if (queued + message.size() > limits.highWatermark) // Client is falling behind
+    {
+        behind_.store(true, std::memory_order_relaxed);
+
+        if (limits.policy == SlowConsumerPolicy::Disconnect) return PushResult::Overflow;
+        if (limits.policy == SlowConsumerPolicy::DropOldest) evictOldest(limits.lowWatermark, message.size());
+    }
+
+    if (behind() && limits.policy == SlowConsumerPolicy::DropNewest) // Keep refusing until it drains
+    {
+        dropped_.store(dropped() + 1, std::memory_order_relaxed);
+        metrics::add(Counter::OutboundDrops);
+        return PushResult::Dropped;
+    }
+
+    queued = bytes() + message.size();
+    messages_.push_back(std::move(message));
+    account(messages_.size(), queued);
+    return PushResult::Queued;
+}
+
+void OutboundQueue::evictOldest(size_t targetBytes, size_t incoming)
+{
+    // The front message may be partly on the wire already, it has to be finished. Pinned ones
+    // are referenced by a write still in progress
+    size_t first = std::max(pinned_, size_t(offset_ > 0 ? 1 : 0));
+    size_t queued = bytes();
+    size_t evicted = 0;
+
+    while (messages_.size() > first && queued + incoming > targetBytes)
+    {
+        auto victim = messages_.begin() + first;
+        queued -= victim->size();
+        messages_.erase(victim);
+        ++evicted;
+    }
+
+    dropped_.store(dropped() + evicted, std::memory_order_relaxed);
+    if (evicted) metrics::add(Counter::OutboundDrops, evicted);
+    account(messages_.size(), queued);
+}
+
+OutboundQueue::FlushResult OutboundQueue::flush(int fd, const OutboundLimits& limits)
+{
+    while (!messages_.empty())
+    {
+        iovec iov[FLUSH_BATCH];
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = gather(iov, FLUSH_BATCH);
+        ssize_t n = sendmsg(fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT); // writev() with MSG_NOSIGNAL
+
+        if (n < 0)
+        {
+            consume(0, limits);
+            if (errno == EINTR) continue;
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? FlushResult::Blocked : FlushResult::Error;
+        }
+        consume(static_cast<size_t>(n), limits);
+    }
+    return FlushResult::Drained;
+}
+
+int OutboundQueue::gather(iovec* iov, int max)
+{
+    int count = 0;
+    size_t skip = offset_;
+
+    for (auto it = messages_.begin(); it != messages_.end() && count < max; ++it)
+    {
+        iov[count].iov_base = const_cast<char*>(it->data() + skip);
+        iov[count].iov_len = it->size() - skip;
+        skip = 0;
+        ++count;
+    }
+    pinned_ = static_cast<size_t>(count);
+    return count;
+}
+
+void OutboundQueue::consume(size_t written, const OutboundLimits& limits)
+{
+    pinned_ = 0;
+    if (written > 0)
+    {
+        size_t queued = bytes() - written;
+        bool sampled = false; // One latency sample per write keeps the clock off the per-message path
+        metrics::add(Counter::BytesOut, written);
+        while (written > 0) // Release every message that went out completely
+        {
+            size_t left = messages_.front().size() - offset_;
+            if (written < left)
+            {
+                offset_ += written;
+                break;
+            }
+            written -= left;
+            offset_ = 0;
+            if (!sampled)
+            {
+                metrics::record(Histogram::RecvToSend, metrics::nowNs() - messages_.front().receivedNs());
+                sampled = true;
+            }
+            messages_.pop_front();
+        }
+        account(messages_.size(), queued);
+    }
+
+    if (behind() && bytes() <= limits.lowWatermark) behind_.store(false, std::memory_order_relaxed); // Caught up
+}
+
+void OutboundQueue::clear()
+{
+    messages_.clear();
+    offset_ = 0;
+    pinned_ = 0;
+    account(0, 0);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <sys/uio.h>
+#include "message_buffer.h"
+#include "slab_pool.h"
+
+// Per-connection queue of messages waiting to be written. Entries are shared references,
+// never copies, and flush() hands up to FLUSH_BATCH of them to the kernel in one
+// scatter-gather call. The queue is bounded by OutboundLimits: once the unwritten bytes
+// would pass the high watermark the client is behind and the slow-consumer policy decides
+// what gives, until the queue drains back below the low watermark.
+
+enum class SlowConsumerPolicy
+{
+    DropOldest, // Evict the oldest unsent messages to make room for the new one
+    DropNewest, // Refuse new messages until the queue drains below the low watermark
+    Disconnect  // Drop the client
+};
+
+struct OutboundLimits
+{
+    size_t highWatermark = 1024 * 1024; // Queued bytes at which the client counts as behind
+    size_t lowWatermark = 256 * 1024; // Queued bytes at which it has caught up again
+    SlowConsumerPolicy policy = SlowConsumerPolicy::DropOldest; // What happens to a client that is behind
+};
+
+class OutboundQueue {
+public:
+    enum class PushResult { Queued, Dropped, Overflow }; // Overflow: the policy asks to disconnect
+    enum class FlushResult { Drained, Blocked, Error };
+
+    static constexpr int FLUSH_BATCH = 64; // iovecs per sendmsg() call
+
+    PushResult push(SharedMessage message, const OutboundLimits& limits); // Append unless the policy refuses it
+    FlushResult flush(int fd, const OutboundLimits& limits); // Write until drained, EAGAIN (Blocked) or a socket error
+    int gather(iovec* iov, int max); // Describe the unwritten front messages, which stay pinned until consume()
+    void consume(size_t written, const OutboundLimits& limits); // Release what a write took and unpin the rest
+    void clear(); // Drop every pending message
+
+    // Counters are written by the owning thread only and may be read from any thread.
+    bool empty() const { return messages_.empty(); }
+    size_t depth() const { return depth_.load(std::memory_order_relaxed); } // Messages pending
+    size_t bytes() const { return bytes_.load(std::memory_order_relaxed); } // Bytes pending
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); } // Messages dropped by the policy
+    bool behind() const { return behind_.load(std::memory_order_relaxed); } // Above the high watermark, not yet below the low one
+
+private:
+    void account(size_t depth, size_t bytes); // Publish the new queue size
+    void evictOldest(size_t targetBytes, size_t incoming); // DropOldest: make room for an incoming message
+
+    std::deque<SharedMessage, SlabAllocator<SharedMessage>> messages_; // Pending messages, front is being written
+    size_t offset_ = 0; // Bytes of the front message already written
+    size_t pinned_ = 0; // Front messages handed out by gather(), not evicted until consume()
+    std::atomic<size_t> depth_{0}; // messages_.size()
+    std::atomic<size_t> bytes_{0}; // Unwritten bytes across the whole queue
+    std::atomic<uint64_t> dropped_{0}; // Messages lost to the slow-consumer policy
+    std::atomic<bool> behind_{false}; // Hysteresis state between the two watermarks
+};
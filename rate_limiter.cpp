@@ -0,0 +1,67 @@
+#include "rate_limiter.h"
+#include <algorithm>
+#include <functional>
+
+void TokenBucket::configure(double rate, double burst, uint64_t nowNs)
+{
+    rate_ = rate;
+    capacity_ = std::max(rate * burst, 1.0);
+    tokens_ = capacity_;
+    last_ns_ = nowNs;
+}
+
+uint64_t TokenBucket::shortfallNs(double amount, uint64_t nowNs)
+{
+    if (rate_ <= 0) return 0;
+    if (nowNs > last_ns_)
+    {
+        tokens_ = std::min(capacity_, tokens_ + (nowNs - last_ns_) * rate_ / 1e9);
+        last_ns_ = nowNs;
+    }
+
+    double needed = std::min(amount, capacity_); // A frame larger than the bucket passes once it is full
+    if (tokens_ >= needed) return 0;
+    return static_cast<uint64_t>((needed - tokens_) / rate_ * 1e9) + 1;
+}
+
+void RoomRateLimiter::configure(const RateLimits& limits)
+{
+    messages_ = limits.roomMessages;
+    bytes_ = limits.roomBytes;
+    burst_ = limits.burst;
+}
+
+uint64_t RoomRateLimiter::take(std::string_view room, size_t bytes, uint64_t nowNs)
+{
+    if (!enabled()) return 0;
+
+    thread_local std::string key; // Keeps its capacity, so names past the short-string buffer don't allocate
+    key.assign(room.data(), room.size());
+    Stripe& stripe = stripes_[std::hash<std::string_view>()(room) % STRIPES];
+    std::lock_guard<std::mutex> lock(stripe.mutex);
+
+    auto it = stripe.rooms.find(key);
+    if (it == stripe.rooms.end())
+    {
+        if (stripe.rooms.size() >= PRUNE_AT) // Rooms quiet for a burst window have refilled, forgetting them changes nothing
+        {
+            uint64_t idleNs = static_cast<uint64_t>(burst_ * 1e9);
+            for (auto old = stripe.rooms.begin(); old != stripe.rooms.end();)
+            {
+                if (nowNs - old->second.last_used_ns > idleNs) old = stripe.rooms.erase(old);
+                else ++old;
+            }
+        }
+        it = stripe.rooms.emplace(key, Buckets()).first;
+        it->second.messages.configure(messages_, burst_, nowNs);
+        it->second.bytes.configure(bytes_, burst_, nowNs);
+    }
+
+    Buckets& buckets = it->second;
+    buckets.last_used_ns = nowNs;
+    uint64_t wait = std::max(buckets.messages.shortfallNs(1, nowNs), buckets.bytes.shortfallNs(double(bytes), nowNs));
+    if (wait > 0) return wait;
+    buckets.messages.take(1);
+    buckets.bytes.take(double(bytes));
+    return 0;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Token buckets for the server's message and byte rate limits. A bucket refills lazily:
+// the tokens earned since the last call are added when it is next asked, so an idle
+// client costs nothing and no refill timer exists. A sender that runs dry is not dropped;
+// the server stops reading its socket and schedules the resume on a TimingWheel at the
+// time the bucket will have refilled, and TCP flow control slows the sender down.
+
+struct RateLimits
+{
+    double clientMessages = 0; // Frames per second per connection, control frames included, 0 for no limit
+    double clientBytes = 0; // Frame bytes per second per connection, 0 for no limit
+    double roomMessages = 0; // Messages per second into one room over all senders, 0 for no limit
+    double roomBytes = 0; // Frame bytes per second into one room, 0 for no limit
+    double burst = 1.0; // Bucket depth, in seconds worth of the rate
+    uint32_t penaltyMs = 0; // Added to every pause once a limit is hit
+
+    bool any() const { return clientMessages > 0 || clientBytes > 0 || roomMessages > 0 || roomBytes > 0; }
+};
+
+class TokenBucket {
+public:
+    void configure(double rate, double burst, uint64_t nowNs); // rate per second, 0 disables the bucket. Starts full
+    bool limited() const { return rate_ > 0; }
+
+    uint64_t shortfallNs(double amount, uint64_t nowNs); // 0 if take(amount) may proceed, else time until it may
+    void take(double amount) { tokens_ -= amount; } // After shortfallNs() returned 0, may go negative for oversized amounts
+
+private:
+    double rate_ = 0; // Tokens per second
+    double capacity_ = 0; // Bucket depth
+    double tokens_ = 0;
+    uint64_t last_ns_ = 0; // Last refill
+};
+
+class RoomRateLimiter { // One message and one byte bucket per room, shared by every thread
+public:
+    void configure(const RateLimits& limits);
+    bool enabled() const { return messages_ > 0 || bytes_ > 0; }
+    uint64_t take(std::string_view room, size_t bytes, uint64_t nowNs); // 0 and tokens taken, or ns until the room has room
+
+private:
+    static constexpr size_t STRIPES = 16;
+    static constexpr size_t PRUNE_AT = 1024; // Rooms per stripe before idle buckets are dropped
+
+    struct Buckets
+    {
+        TokenBucket messages;
+        TokenBucket bytes;
+        uint64_t last_used_ns = 0;
+    };
+
+    struct Stripe
+    {
+        std::mutex mutex;
+        std::unordered_map<std::string, Buckets> rooms;
+    };
+
+    double messages_ = 0;
+    double bytes_ = 0;
+    double burst_ = 1.0;
+    Stripe stripes_[STRIPES];
+};
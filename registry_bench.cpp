@@ -0,0 +1,137 @@
+#include "server.h"
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+
+// Broadcast throughput vs connect/disconnect churn: ClientRegistry against the
+// mutex-protected std::vector<int> the server used before.
+
+using Clock = std::chrono::steady_clock;
+
+const int MEMBERS = 1000; // Steady connections every broadcast walks
+const int BROADCASTERS = 2; // Threads iterating the client set
+const double SECONDS = 1.0; // Duration of each measurement
+
+__attribute__((noinline)) long visit(long acc, int fd) // Stand-in for queueing to one client
+{
+    return acc * 31 + fd;
+}
+
+struct LockedVector // Baseline: global mutex, linear erase
+{
+    std::mutex mutex;
+    std::vector<int> sockets;
+
+    void add(int fd)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        sockets.push_back(fd);
+    }
+
+    void remove(int fd)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = std::find(sockets.begin(), sockets.end(), fd);
+        if (it != sockets.end()) sockets.erase(it);
+    }
+
+    long walk()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        long sum = 0;
+        for (int fd : sockets) sum = visit(sum, fd);
+        return sum;
+    }
+};
+
+// Run broadcasters for SECONDS while one thread joins and leaves churnPerSec times per second.
+// Returns broadcasts per second across all broadcaster threads.
+template <typename Walk, typename Churn>
+double measure(Walk walk, Churn churn, int churnPerSec)
+{
+    std::atomic<bool> done{false};
+    std::atomic<long> broadcasts{0};
+    std::atomic<long> sink{0};
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < BROADCASTERS; ++t)
+    {
+        threads.emplace_back([&]()
+        {
+            long local = 0;
+            long acc = 0;
+            while (!done.load(std::memory_order_relaxed))
+            {
+                acc += walk();
+                ++local;
+            }
+            broadcasts += local;
+            sink += acc;
+        });
+    }
+
+    std::thread churner([&]()
+    {
+        if (churnPerSec == 0) return;
+        auto interval = std::chrono::nanoseconds(1000000000LL / churnPerSec);
+        auto next = Clock::now();
+        int i = 0;
+        while (!done.load(std::memory_order_relaxed))
+        {
+            churn(i++);
+            next += interval;
+            if (next > Clock::now()) std::this_thread::sleep_until(next);
+        }
+    });
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(SECONDS));
+    done = true;
+    for (auto& t : threads) t.join();
+    churner.join();
+    return broadcasts / SECONDS;
+}
+
+int main()
+{
+    std::vector<std::unique_ptr<Connection>> members;
+    for (int i = 0; i < MEMBERS + 1; ++i)
+    {
+        members.push_back(std::make_unique<Connection>());
+        members.back()->fd = 1000 + i;
+    }
+    Connection& churning = *members.back();
+
+    std::cout << "=== Registry Benchmark (" << MEMBERS << " members, " << BROADCASTERS << " broadcasters) ===" << std::endl;
+    std::cout << std::left << std::setw(14) << "churn/s" << std::setw(22) << "mutex+vector bcast/s"
+              << "registry bcast/s" << std::endl;
+
+    for (int churnPerSec : {0, 1000, 10000, 100000})
+    {
+        LockedVector locked;
+        for (int i = 0; i < MEMBERS; ++i) locked.add(members[i]->fd);
+        double lockedRate = measure([&]() { return locked.walk(); },
+                                    [&](int) { locked.add(churning.fd); locked.remove(churning.fd); },
+                                    churnPerSec);
+
+        ClientRegistry registry;
+        for (int i = 0; i < MEMBERS; ++i) members[i]->registry_slot = registry.add(members[i].get());
+        double registryRate = measure([&]()
+                                      {
+                                          long sum = 0;
+                                          registry.forEach([&sum](Connection& c) { sum = visit(sum, c.fd); });
+                                          return sum;
+                                      },
+                                      [&](int) { registry.remove(registry.add(&churning)); },
+                                      churnPerSec);
+
+        std::cout << std::left << std::setw(14) << churnPerSec << std::setw(22) << std::fixed << std::setprecision(0)
+                  << lockedRate << registryRate << std::endl;
+        std::cout << "RESULT churn=" << churnPerSec << " mutex_vector=" << lockedRate << " registry=" << registryRate << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include "room_table.h"
+#include <algorithm>
+#include <functional>
+
+RoomTable::RoomTable(size_t stripes) : stripes_(stripes == 0 ? 1 : stripes) {} // Constructor
+
+RoomTable::Stripe& RoomTable::stripeOf(std::string_view room)
+{
+    return stripes_[std::hash<std::string_view>()(room) % stripes_.size()];
+}
+
+std::shared_ptr<RoomTable::Room> RoomTable::find(std::string_view room)
+{
+    thread_local std::string key; // Grows to the longest room name once, lookups allocate nothing after that
+    key.assign(room.data(), room.size());
+    Stripe& stripe = stripeOf(room);
+    std::lock_guard<std::mutex> lock(stripe.mutex);
+    auto it = stripe.rooms.find(key);
+    return it == stripe.rooms.end() ? nullptr : it->second;
+}
+
+bool RoomTable::join(std::string_view room, Connection* conn)
+{
+    Stripe& stripe = stripeOf(room);
+    std::lock_guard<std::mutex> lock(stripe.mutex); // Held so an emptied room can't be erased under us
+
+    std::shared_ptr<Room>& r = stripe.rooms[std::string(room)];
+    if (!r) r = std::make_shared<Room>();
+
+    std::unique_lock<std::shared_mutex> members(r->mutex); // Waits for fan-outs of this room only
+    if (std::find(r->members.begin(), r->members.end(), conn) != r->members.end()) return false;
+    r->members.push_back(conn);
+    return true;
+}
+
+bool RoomTable::leave(std::string_view room, Connection* conn)
+{
+    Stripe& stripe = stripeOf(room);
+    std::lock_guard<std::mutex> lock(stripe.mutex);
+
+    auto it = stripe.rooms.find(std::string(room));
+    if (it == stripe.rooms.end()) return false;
+
+    std::shared_ptr<Room> r = it->second;
+    std::unique_lock<std::shared_mutex> members(r->mutex); // Returns once no fan-out can still reach conn
+    auto pos = std::find(r->members.begin(), r->members.end(), conn);
+    if (pos == r->members.end()) return false;
+
+    *pos = r->members.back();
+    r->members.pop_back();
+    if (r->members.empty()) stripe.rooms.erase(it); // A fan-out still holding r just sees no members
+    return true;
+}
+
+size_t RoomTable::members(std::string_view room)
+{
+    std::shared_ptr<Room> r = find(room);
+    if (!r) return 0;
+
+    std::shared_lock<std::shared_mutex> lock(r->mutex);
+    return r->members.size();
+}
+
+size_t RoomTable::roomCount()
+{
+    size_t count = 0;
+    for (Stripe& stripe : stripes_)
+    {
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        count += stripe.rooms.size();
+    }
+    return count;
+}
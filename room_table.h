@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct Connection;
+
+// Named rooms and their members, for the threaded server. The room directory is split into
+// stripes by name hash, and each room guards its own member list: a fan-out only walks the
+// members of one room under that room's shared lock, so joins and leaves in one room never
+// wait on broadcasts to another. Stripe locks are held for a map lookup only.
+
+class RoomTable {
+public:
+    explicit RoomTable(size_t stripes = 64); // Constructor
+
+    bool join(std::string_view room, Connection* conn); // false if already a member
+    bool leave(std::string_view room, Connection* conn); // false if not a member
+    size_t members(std::string_view room); // Member count, 0 for unknown rooms
+    size_t roomCount(); // Rooms with at least one member
+
+    template <typename F>
+    size_t forEachMember(std::string_view room, F&& fn) // Calls fn(Connection&) under the room's shared lock
+    {
+        std::shared_ptr<Room> r = find(room);
+        if (!r) return 0;
+
+        std::shared_lock<std::shared_mutex> lock(r->mutex);
+        for (Connection* conn : r->members) fn(*conn);
+        return r->members.size();
+    }
+
+private:
+    struct Room
+    {
+        std::shared_mutex mutex; // Shared by fan-outs, exclusive for join/leave
+        std::vector<Connection*> members; // Unordered, removal swaps with the last member
+    };
+
+    struct Stripe
+    {
+        std::mutex mutex; // Guards rooms
+        std::unordered_map<std::string, std::shared_ptr<Room>> rooms; // Rooms whose name hashes here
+    };
+
+    Stripe& stripeOf(std::string_view room);
+    std::shared_ptr<Room> find(std::string_view room); // Null if the room has no members
+
+    std::vector<Stripe> stripes_;
+};
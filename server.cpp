@@ -1,5 +1,6 @@
 #include "server.h"
-#include <iostream>
+#include "metrics.h"
+#include "logger.h"
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netdb.h>
@@ -7,22 +8,64 @@
 #include <arpa/inet.h>
 #include <cstring>
 #include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <chrono>
 
-Server::Server(int port) : port(port), running(false), listening(-1) {} // Constructor
+namespace
+{
+    // io_uring user_data: the Connection pointer (8-byte aligned) with the request kind in the low bits
+    constexpr uint64_t URING_ACCEPT = 1;
+    constexpr uint64_t URING_WAKE = 2;
+    constexpr uint64_t URING_RECV = 3;
+    constexpr uint64_t URING_SEND = 4;
+    constexpr uint64_t URING_CANCEL = 5; // No pointer: the client may be gone when it completes
+    constexpr uint64_t URING_KIND_MASK = 7;
+
+    uint64_t uringTag(Connection* conn, uint64_t kind)
+    {
+        return reinterpret_cast<uint64_t>(conn) | kind;
+    }
+
+    uint64_t nowMs() // Timing wheel clock
+    {
+        return metrics::nowNs() / 1000000;
+    }
+}
+
+Server::Server(int port, const ServerOptions& options)
+    : running(false), port(port), listening(-1), options(options), archive(options.archive), workers(options.workers), dispatch_timers(nowMs()),
+      history(options.history), epoch_ms(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count()) // Constructor
+{
+    room_limits.configure(options.limits);
+    names.setMaxRooms(options.maxRooms);
+    ping_frame = SharedMessage::create(encodeFrame(FrameType::Ping, std::string_view()), FRAME_HEADER_SIZE, -1);
+}
 
 Server::~Server() 
 {
     stop(); // Ensure server is stopped on destruction
 }
 
-void Server::start() 
+int Server::createListeningSocket(bool reusePort)
 {
-    listening = socket(AF_INET, SOCK_STREAM, 0); // Create a TCP socket
+    int sock = socket(AF_INET, SOCK_STREAM, 0); // Create a TCP socket
     
-    if (listening == -1) // Check for socket creation error
+    if (sock == -1) // Check for socket creation error
     {
-        std::cerr << "✗ Can't create server socket!" << std::endl;
-        return;
+        logger::error("✗ Can't create server socket!");
+        return -1;
+    }
+
+    int one = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)); // Rebind right after a restart
+    if (reusePort && setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) == -1)
+    {
+        logger::error("✗ Can't enable SO_REUSEPORT!");
+        close(sock);
+        return -1;
     }
 
     sockaddr_in hint;
@@ -30,106 +73,486 @@ void Server::start()
     hint.sin_port = htons(port);
     inet_pton(AF_INET, "0.0.0.0", &hint.sin_addr); // Use default IP address 0.0.0.0
 
-    if (bind(listening, (sockaddr*)&hint, sizeof(hint)) == -1) // Bind the socket to the IP/port
+    if (bind(sock, (sockaddr*)&hint, sizeof(hint)) == -1) // Bind the socket to the IP/port
+    {
+        logger::error("✗ Can't bind to port!");
+        close(sock);
+        return -1;
+    }
+
+    if (listen(sock, SOMAXCONN) == -1) // Mark the socket for listening
+    {
+        logger::error("✗ Can't listen!");
+        close(sock);
+        return -1;
+    }
+
+    return sock;
+}
+
+void Server::start() 
+{
+    if (!options.log.directory.empty()) // Persist history: the archive consumer appends every batch
+    {
+        message_log = std::make_unique<MessageLog>(options.log);
+        if (!message_log->open())
+        {
+            logger::error("✗ Can't open message log in ", options.log.directory);
+            message_log.reset();
+            return;
+        }
+        logger::info("🗄 Message log recovered ", std::to_string(message_log->stats().recovered) + " record(s), next sequence " +
+                     std::to_string(message_log->nextSequence()));
+    }
+
+    archive.setSink([this](const SharedMessage* batch, size_t count)
+    {
+        if (message_log)
+        {
+            uint64_t oversized = message_log->stats().oversized;
+            message_log->appendBatch(batch, count); // Group commit per batch
+            metrics::add(Counter::LogOversized, message_log->stats().oversized - oversized);
+        }
+        if (archive_sink) archive_sink(batch, count);
+    });
+    archive.setIdle([this]() { return message_log ? message_log->syncDue() : -1; }); // Interval sync after the last batch
+    archive.start(); // Consumer must run before the first message can arrive
+
+    if (options.adminPort != 0)
+    {
+        if (admin.start(options.adminPort, [this]() { return metricsText(); }))
+            logger::info("📊 Metrics served on 127.0.0.1:", std::to_string(options.adminPort));
+        else
+            logger::error("✗ Can't open admin port ", std::to_string(options.adminPort));
+    }
+
+    if (options.mode == ServerMode::Uring && !Uring::supported())
+    {
+        logger::warn("⚠ io_uring unavailable (", std::string(strerror(errno)) + "), falling back to epoll");
+        options.mode = ServerMode::Epoll;
+    }
+
+    if (options.mode == ServerMode::Epoll || options.mode == ServerMode::Uring)
     {
-        std::cerr << "✗ Can't bind to port!" << std::endl;
+        bool uring = options.mode == ServerMode::Uring;
+        int count = std::max(1, options.shards);
+        for (int i = 0; i < count; ++i)
+        {
+            auto shard = std::make_unique<Shard>();
+            shard->index = i;
+            shard->history = HistoryRing(options.history);
+            shards.push_back(std::move(shard));
+        }
+
+        for (auto& shard : shards) // Every listener must exist before any loop starts posting
+        {
+            if (!(uring ? startUringShard(*shard) : startShard(*shard)))
+            {
+                stop();
+                return;
+            }
+        }
+
+        running = true;
+        for (auto& shard : shards)
+        {
+            shard->thread = std::thread(uring ? &Server::uringLoop : &Server::eventLoop, this, std::ref(*shard));
+        }
+        logger::info("🖥 Server started on port ", std::to_string(port) + (uring ? " (io_uring, " : " (epoll, ") + std::to_string(count) + " shard(s))");
         return;
     }
 
-    if (listen(listening, SOMAXCONN) == -1) // Mark the socket for listening
+    listening = createListeningSocket(false);
+    if (listening == -1) return;
+    fcntl(listening, F_SETFL, fcntl(listening, F_GETFL, 0) | O_NONBLOCK); // Accepts run on the dispatcher
+
+    writer_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    writer_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    dispatch_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    dispatch_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (writer_epoll_fd == -1 || writer_wake_fd == -1 || dispatch_epoll_fd == -1 || dispatch_wake_fd == -1)
     {
-        std::cerr << "✗ Can't listen!" << std::endl;
+        logger::error("✗ Can't create epoll instance!");
+        stop();
         return;
     }
 
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = WRITER_WAKE_TAG;
+    epoll_ctl(writer_epoll_fd, EPOLL_CTL_ADD, writer_wake_fd, &ev);
+    epoll_ctl(dispatch_epoll_fd, EPOLL_CTL_ADD, dispatch_wake_fd, &ev);
+    ev.data.u64 = LISTEN_TAG;
+    epoll_ctl(dispatch_epoll_fd, EPOLL_CTL_ADD, listening, &ev);
+
     running = true;
-    std::thread(&Server::acceptClients, this).detach(); // Start accepting clients in a separate thread
-    std::cout << "🖥 Server started on port " << port << std::endl;
+    workers.start();
+    writer_thread = std::thread(&Server::writerLoop, this); // Drains backlogged clients once writable
+    dispatch_thread = std::thread(&Server::dispatchLoop, this); // Accepts and hands readable clients to the pool
+    logger::info("🖥 Server started on port ", std::to_string(port) + " (threaded, " + std::to_string(workers.size()) + " worker(s))");
 }
 
 void Server::stop() 
 {
+    admin.stop(); // Snapshots read the registry, stop them first
     running = false;
-    if (listening != -1) 
+
+    for (auto& shard : shards) // Epoll and Uring modes: wake every loop and let it close its clients
     {
-        shutdown(listening, SHUT_RDWR); // Disable further send/receive operations
-        close(listening); // Close the listening socket
-        listening = -1;
+        if (shard->thread.joinable())
+        {
+            uint64_t one = 1;
+            ssize_t ignored = write(shard->wake_fd, &one, sizeof(one));
+            (void)ignored;
+            shard->thread.join();
+        }
+
+        if (shard->listening != -1) close(shard->listening);
+        if (shard->epoll_fd != -1) close(shard->epoll_fd);
+        if (shard->wake_fd != -1) close(shard->wake_fd);
+
+        InboundMessage* msg = shard->inbox.exchange(nullptr); // Messages posted after the loop exited
+        while (msg != nullptr)
+        {
+            InboundMessage* next = msg->next;
+            delete msg;
+            msg = next;
+        }
     }
+    shards.clear();
 
-    std::lock_guard<std::mutex> lock(clients_mutex); // Lock the clients list for safe access
-    
-    for (int clientSock : client_sockets)  // Close all client sockets
+    if (writer_thread.joinable()) // Threaded mode: stop draining backlogged clients
     {
-        shutdown(clientSock, SHUT_RDWR);
-        close(clientSock);
+        uint64_t one = 1;
+        ssize_t ignored = write(writer_wake_fd, &one, sizeof(one));
+        (void)ignored;
+        writer_thread.join();
     }
+    if (writer_epoll_fd != -1) close(writer_epoll_fd);
+    if (writer_wake_fd != -1) close(writer_wake_fd);
+    writer_epoll_fd = -1;
+    writer_wake_fd = -1;
 
-    client_sockets.clear(); // Clear the client sockets list
+    if (dispatch_thread.joinable()) // Threaded mode: no new client and no new task after this
+    {
+        uint64_t one = 1;
+        ssize_t ignored = write(dispatch_wake_fd, &one, sizeof(one));
+        (void)ignored;
+        dispatch_thread.join();
+    }
+    workers.stop(); // Runs the tasks already handed out, then joins every worker
 
-    for (std::thread& t : client_threads)  // Join all client handling threads
+    std::vector<Connection*> remaining; // Nothing else touches a client now, close them here
+    registry.forEach([&remaining](Connection& conn) { remaining.push_back(&conn); });
+    for (Connection* conn : remaining)
     {
-        if (t.joinable()) // Check if thread is joinable
-        {
-            t.join();
-        }
+        std::unique_ptr<Connection> owned(conn);
+        remove_client(*conn);
+    }
+
+    if (dispatch_epoll_fd != -1) close(dispatch_epoll_fd);
+    if (dispatch_wake_fd != -1) close(dispatch_wake_fd);
+    dispatch_epoll_fd = -1;
+    dispatch_wake_fd = -1;
+
+    if (listening != -1) 
+    {
+        close(listening); // Close the listening socket
+        listening = -1;
     }
+
+    archive.stop(); // No producer left: drain the ring and join the consumer
+    if (message_log) message_log->close(); // Final sync of the current segment
 }
 
 int Server::get_connection_count() 
 {
-    std::lock_guard<std::mutex> lock(clients_mutex); // Lock the clients list for safe access
-    return client_sockets.size(); // Return the number of active clients
+    return static_cast<int>(registry.size()); // Return the number of active clients
 }
 
-void Server::remove_client(int clientSock)  // Remove a client from the list
+void Server::remove_client(Connection& conn)  // Remove a client from the list
 {
-    std::lock_guard<std::mutex> lock(clients_mutex); // Lock the clients list for safe access
-    auto it = std::find(client_sockets.begin(), client_sockets.end(), clientSock); // Find the client socket
+    {
+        std::lock_guard<std::mutex> lock(timers_mutex); // The dispatcher must not fire for it once it is freed
+        dispatch_timers.cancel(conn.idle_timer);
+        dispatch_timers.cancel(conn.resume_timer);
+    }
+    if (conn.session_id != 0) directory.remove(conn.name, conn.session_id); // Waits for direct messages still delivering to it
+    for (const std::string& room : conn.rooms) rooms.leave(room, &conn); // No room fan-out can reach it after this
+    conn.rooms.clear();
 
-    if (it != client_sockets.end())  
+    registry.remove(conn.registry_slot); // Returns once no broadcaster can still see the client
+    metrics::add(Counter::ConnectionsClosed);
+    conn.registry_slot = ClientRegistry::NO_SLOT;
+
+    if (conn.session_id != 0) // Everyone drops the name
     {
-        close(clientSock);
-        client_sockets.erase(it);
+        std::lock_guard<std::mutex> lock(history_mutex); // Ordered against the name snapshot taken at accept
+        names.removeUser(conn.session_id);
+        announce(nameFrame(NameKind::User, conn.session_id, std::string_view()));
     }
+    if (writer_epoll_fd != -1) epoll_ctl(writer_epoll_fd, EPOLL_CTL_DEL, conn.fd, nullptr);
+
+    std::lock_guard<std::mutex> lock(conn.out_mutex); // The writer thread may be flushing right now
+    conn.closed = true;
+    conn.outq.clear();
+    close(conn.fd);
 }
 
-void Server::handleClient(int clientSock) // Handle communication with a client
+void Server::handleClient(Connection* conn) // Handle communication with a client
 {
-    char buf[4096]; // Buffer for receiving data
+    int clientSock = conn->fd;
+    FrameDecoder& decoder = conn->decoder; // Reassembles frames split or merged by TCP
+    conn->paused = false; // Resumed by the dispatcher: the frames the rate limit held back go first
+    conn->read_deficit += static_cast<int64_t>(options.readQuantum);
+    bool open = processFrames(*conn); // Left over from the last turn
+    bool drained = false;
 
-    while (running) 
+    while (open && !conn->paused && conn->read_deficit > 0) // Bounded by the quantum, so one busy client can't hold a worker
     {
-        memset(buf, 0, sizeof(buf));
-        int bytesReceived = recv(clientSock, buf, sizeof(buf), 0); // Receive data from client
+        char* buf = decoder.writePtr();
+        int bytesReceived = recv(clientSock, buf, decoder.writable(), MSG_DONTWAIT); // Receive data from client
         
+        if (bytesReceived == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) // Drained, back to the dispatcher
+        {
+            drained = true;
+            break;
+        }
         if (bytesReceived <= 0) 
         {
-            std::cout << "⚠ Client disconnected" << std::endl;
-            remove_client(clientSock);
+            if (bytesReceived == -1 && errno == EINTR) continue;
+            logger::warn("⚠ Client disconnected");
+            open = false;
             break;
         }
+        decoder.commit(bytesReceived);
+        metrics::add(Counter::BytesIn, bytesReceived);
+        conn->last_heard_ms.store(nowMs(), std::memory_order_relaxed);
+        open = processFrames(*conn);
+    }
+
+    if (open && conn->paused) // Throttled: the socket stays unread, so the kernel pushes back on the sender
+    {
+        pauseClient(*conn);
+        return;
+    }
 
-        std::string msg(buf, bytesReceived);
-        std::cout << "✉  " << msg << std::endl;
-        broadcast(msg, clientSock); // Broadcast message to other clients
+    if (open && !drained) // Quantum spent: queue behind the clients already waiting for this worker
+    {
+        workers.submit([this, conn]() { handleClient(conn); }, static_cast<size_t>(clientSock)); // Fails in stop(), which removes it
+        return;
+    }
+    conn->read_deficit = std::min<int64_t>(conn->read_deficit, 0); // Deficit round-robin: an idle client saves up no credit
+
+    if (open) // Level-triggered one-shot: fires again right away if data is left
+    {
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLONESHOT;
+        ev.data.ptr = conn;
+        if (epoll_ctl(dispatch_epoll_fd, EPOLL_CTL_MOD, clientSock, &ev) == 0) return;
     }
+
+    std::unique_ptr<Connection> owned(conn); // This task was the only one holding it
+    remove_client(*conn);
 }
 
-void Server::broadcast(const std::string& message, int senderSock) 
+bool Server::processFrames(Connection& conn)
 {
-    std::lock_guard<std::mutex> lock(clients_mutex); // Lock the clients list for safe access
-    
-    for (int clientSock : client_sockets) // Send message to all clients except the sender 
+    FrameView frame;
+    FrameDecoder::Status status = FrameDecoder::Status::NeedMore;
+    uint64_t frames = 0;
+    while (!conn.paused && conn.read_deficit > 0 && (status = conn.decoder.next(frame)) == FrameDecoder::Status::Frame)
+    {
+        if (!handleFrame(conn, frame))
+        {
+            conn.decoder.putBack(frame); // Handled once the client is resumed
+            break;
+        }
+        conn.read_deficit -= static_cast<int64_t>(frame.wire.size());
+        ++frames;
+    }
+    metrics::add(Counter::FramesIn, frames);
+
+    if (status == FrameDecoder::Status::Error)
+    {
+        logger::warn("⚠ Client sent an invalid frame, disconnecting");
+        return false;
+    }
+    return true;
+}
+
+bool Server::handleFrame(Connection& conn, const FrameView& frame)
+{
+    if (!admit(conn, frame)) return false;
+
+    switch (frame.type)
+    {
+    case FrameType::Chat:
+        logger::sample(LogLevel::Info, "✉  ", frame.payload); // Rate-limited by --log-sample
+        broadcast(frame, conn.fd); // Broadcast message to other clients
+        break;
+    case FrameType::Join: joinRoom(conn, frame.payload); break;
+    case FrameType::Leave: leaveRoom(conn, frame.payload); break;
+    case FrameType::RoomChat:
+    {
+        std::string_view room, text;
+        if (!parseRoomPayload(frame.payload, room, text)) break;
+        broadcastRoom(frame, room, conn.fd);
+        break;
+    }
+    case FrameType::Hello: hello(conn, frame.payload); break;
+    case FrameType::Ping: deliver(conn, pongFrame(frame.payload)); break;
+    case FrameType::Direct:
+        direct(conn, frame);
+        break;
+    case FrameType::Message:
+    {
+        std::string_view room, text;
+        if (!acceptMessage(conn, frame, room, text)) break;
+        logger::sample(LogLevel::Info, "✉  ", text);
+        if (room.empty()) broadcast(frame, conn.fd); else broadcastRoom(frame, room, conn.fd);
+        break;
+    }
+    default: break; // Unknown types are ignored
+    }
+    return true;
+}
+
+void Server::pauseClient(Connection& conn)
+{
+    {
+        std::lock_guard<std::mutex> lock(timers_mutex);
+        if (dispatch_timers.size() == 0) dispatch_timers.advance(nowMs(), [](TimerNode&) {}); // Idle wheel: catch up its clock
+        dispatch_timers.schedule(conn.resume_timer, conn.resume_ms);
+    }
+    uint64_t one = 1; // The dispatcher may be sleeping without a timeout
+    ssize_t ignored = write(dispatch_wake_fd, &one, sizeof(one));
+    (void)ignored;
+}
+
+void Server::broadcast(const FrameView& frame, int senderSock) 
+{
+    SharedMessage message = SharedMessage::create(frame.wire, FRAME_HEADER_SIZE, senderSock); // The only copy
+    {
+        std::lock_guard<std::mutex> lock(history_mutex);
+        message.setSequence(history.total() + 1); // Clients accepted after this point got it from history
+        history.push(message);
+    }
+
+    uint64_t deliveries = 0;
+    registry.forEach([&](Connection& conn) // Lock-free walk: queue the message for all clients except the sender
     {
-        if (clientSock != senderSock) 
+        if (conn.fd != senderSock) 
         {
-            send(clientSock, message.c_str(), message.size(), 0); // Send the message
+            deliver(conn, message); // Never blocks on a slow socket
+            ++deliveries;
         }
+    });
+    metrics::add(Counter::MessagesBroadcast);
+    metrics::add(Counter::Deliveries, deliveries);
+
+    addMessageToQueue(message); // Add message to the queue for archiving
+}
+
+void Server::joinRoom(Connection& conn, std::string_view room)
+{
+    if (room.empty() || room.size() > MAX_ROOM_NAME) return;
+    uint32_t id = conn.session_id != 0 ? names.internRoom(room) : 0; // Interned only as it gets a member
+    if (conn.session_id != 0 && id == 0)
+    {
+        logger::warn("⚠ Room table full, join refused");
+        return;
     }
+    if (rooms.join(room, &conn)) conn.rooms.emplace_back(room);
+    if (id != 0) deliver(conn, nameFrame(NameKind::Room, id, room)); // Room id for its Message frames
+}
+
+void Server::leaveRoom(Connection& conn, std::string_view room)
+{
+    if (!rooms.leave(room, &conn)) return;
+    conn.rooms.erase(std::find(conn.rooms.begin(), conn.rooms.end(), room));
+}
+
+void Server::broadcastRoom(const FrameView& frame, std::string_view room, int senderSock)
+{
+    SharedMessage message = SharedMessage::create(frame.wire, FRAME_HEADER_SIZE, senderSock); // Forwarded verbatim
+    uint64_t deliveries = 0;
+    rooms.forEachMember(room, [&](Connection& conn) // Touches this room's members only
+    {
+        if (conn.fd != senderSock) { deliver(conn, message); ++deliveries; }
+    });
+    metrics::add(Counter::MessagesBroadcast);
+    metrics::add(Counter::Deliveries, deliveries);
+
+    addMessageToQueue(message); // Archived like any other message, but kept out of the join history
+}
+
+void Server::dispatchLoop()
+{
+    const int MAX_EVENTS = 256;
+    epoll_event events[MAX_EVENTS];
+
+    while (running)
+    {
+        int timeout;
+        {
+            std::lock_guard<std::mutex> lock(timers_mutex);
+            timeout = dispatch_timers.timeoutMs(nowMs()); // -1 unless a client is throttled or heartbeats are on
+        }
+        int n = epoll_wait(dispatch_epoll_fd, events, MAX_EVENTS, timeout);
+        if (n == -1)
+        {
+            if (errno == EINTR) continue;
+            logger::error("✗ epoll_wait: ", strerror(errno));
+            break;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(timers_mutex); // remove_client() cancels under it, so every owner is alive
+            uint64_t now = nowMs();
+            dispatch_timers.advance(now, [this, now](TimerNode& timer)
+            {
+                Connection* conn = static_cast<Connection*>(timer.owner);
+                if (&timer == &conn->resume_timer) // Refilled: back to a worker, which reads again
+                {
+                    workers.submit([this, conn]() { handleClient(conn); }, static_cast<size_t>(conn->fd));
+                    return;
+                }
+                switch (checkIdle(dispatch_timers, *conn, now))
+                {
+                case Liveness::Ping:
+                    deliver(*conn, ping_frame);
+                    metrics::add(Counter::PingsSent);
+                    break;
+                case Liveness::Dead: // Like a slow client: the read task that sees the hangup removes it
+                    logger::warn("⚠ Client idle for too long, disconnecting");
+                    metrics::add(Counter::IdleEvictions);
+                    shutdown(conn->fd, SHUT_RDWR);
+                    break;
+                case Liveness::Alive: break;
+                }
+            });
+        }
 
-    // std::cout << "Broadcasted message to clients" << std::endl;
-    addMessageToQueue(message, senderSock); // Add message to the queue for broadcasting
+        for (int i = 0; i < n && running; ++i)
+        {
+            if (events[i].data.u64 == WRITER_WAKE_TAG) // stop() or a newly paused client
+            {
+                uint64_t count;
+                ssize_t ignored = read(dispatch_wake_fd, &count, sizeof(count));
+                (void)ignored;
+                continue;
+            }
+            if (events[i].data.u64 == LISTEN_TAG)
+            {
+                acceptClients();
+                continue;
+            }
+
+            Connection* conn = static_cast<Connection*>(events[i].data.ptr); // Disarmed until its task re-arms it
+            workers.submit([this, conn]() { handleClient(conn); }, static_cast<size_t>(conn->fd)); // Same worker unless stolen
+        }
+    }
 }
 
 void Server::acceptClients() {
@@ -138,46 +561,1175 @@ void Server::acceptClients() {
         socklen_t clientSize = sizeof(client);
 
         // Attempt to accept a new client connection
-        int clientSocket = accept(listening, (sockaddr*)&client, &clientSize);
+        int clientSocket = accept4(listening, (sockaddr*)&client, &clientSize, SOCK_CLOEXEC);
+        if (clientSocket == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) logger::error("✗ accept: ", strerror(errno));
+            break; // Backlog drained
+        }
 
-        // Check if a new connection was accepted
-        if (clientSocket != -1) {
-            {
-                std::lock_guard<std::mutex> lock(clients_mutex);
-                client_sockets.push_back(clientSocket);
-            }
+        auto conn = std::make_unique<Connection>();
+        conn->fd = clientSocket;
+        initLimits(*conn);
+        {
+            std::lock_guard<std::mutex> lock(timers_mutex);
+            armHeartbeat(dispatch_timers, *conn);
+        }
+        {
+            std::lock_guard<std::mutex> lock(history_mutex); // No broadcast slips between snapshot and registration
+            std::lock_guard<std::mutex> out(conn->out_mutex);
+            if (SharedMessage snapshot = namesSnapshot()) conn->outq.push(snapshot, options.outbound); // Names before the history using them
+            history.forEach([&](const SharedMessage& message) { conn->outq.push(message, options.outbound); });
+            conn->history_cutoff = history.total();
+            conn->registry_slot = registry.add(conn.get()); // Visible to broadcasters from now on
+            metrics::add(Counter::ConnectionsAccepted);
+        }
+
+        epoll_event ev{};
+        ev.events = EPOLLOUT | EPOLLET; // Edge raised whenever a backlogged socket drains
+        ev.data.u64 = (uint64_t(conn->registry_slot) << 32) | uint32_t(clientSocket);
+        epoll_ctl(writer_epoll_fd, EPOLL_CTL_ADD, clientSocket, &ev);
+
+        {
+            std::lock_guard<std::mutex> out(conn->out_mutex);
+            if (!conn->outq.empty()) conn->outq.flush(clientSocket, options.outbound); // History in one sendmsg, the rest on EPOLLOUT
+        }
+
+        // Log the new connection
+        char clientIP[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &client.sin_addr, clientIP, INET_ADDRSTRLEN);
+        logger::info("✓ New client connected from ", clientIP);
+
+        ev.events = EPOLLIN | EPOLLONESHOT; // A pool task serves it whenever it becomes readable
+        ev.data.ptr = conn.get();
+        epoll_ctl(dispatch_epoll_fd, EPOLL_CTL_ADD, clientSocket, &ev);
+        conn.release(); // Owned by whichever task reads it last, or by stop()
+    }
+}
+
+void Server::deliver(Connection& conn, const SharedMessage& message)
+{
+    std::lock_guard<std::mutex> lock(conn.out_mutex);
+    if (conn.closed) return;
+    if (message.sequence() != 0 && message.sequence() <= conn.history_cutoff) return; // Already queued from history at accept
+
+    bool idle = conn.outq.empty();
+    OutboundQueue::PushResult result = conn.outq.push(message, options.outbound);
+
+    if (result == OutboundQueue::PushResult::Overflow) // Disconnect policy: the next read task cleans up
+    {
+        logger::warn("⚠ Disconnecting slow client");
+        metrics::add(Counter::SlowDisconnects);
+        shutdown(conn.fd, SHUT_RDWR);
+        return;
+    }
+    if (result == OutboundQueue::PushResult::Queued && idle) // Otherwise the writer thread owns the flush
+    {
+        if (conn.outq.flush(conn.fd, options.outbound) == OutboundQueue::FlushResult::Error)
+            shutdown(conn.fd, SHUT_RDWR);
+    }
+}
+
+void Server::hello(Connection& conn, std::string_view name)
+{
+    std::lock_guard<std::mutex> lock(history_mutex); // Ordered against the name snapshot taken at accept
+    uint32_t id = registerSession(conn, name);
+    if (id == 0) return;
+
+    directory.add(name, DirectoryEntry{&conn, id, -1});
+    deliver(conn, welcomeFrame(id));
+    announce(nameFrame(NameKind::User, id, name)); // The new client included: it learns its own name like any other
+}
+
+void Server::announce(const SharedMessage& message)
+{
+    registry.forEach([&](Connection& conn) { deliver(conn, message); });
+}
 
-            // Start a new thread to handle the client's communication
-            std::thread(&Server::handleClient, this, clientSocket).detach();
+void Server::direct(Connection& conn, const FrameView& frame)
+{
+    std::string_view to, text;
+    if (!acceptDirect(conn, frame, to, text)) return;
+
+    SharedMessage message = SharedMessage::create(frame.wire, FRAME_HEADER_SIZE, conn.fd); // Forwarded verbatim
+    uint64_t deliveries = 0;
+    directory.forEach(to, [&](const DirectoryEntry& entry) // One hash lookup, entries stay alive under its lock
+    {
+        if (entry.conn != &conn) { deliver(*entry.conn, message); ++deliveries; }
+    });
+    metrics::add(deliveries != 0 ? Counter::DirectMessages : Counter::DirectUndeliverable);
+    metrics::add(Counter::Deliveries, deliveries);
+
+    addMessageToQueue(message); // Archived like any other message, never kept in the join history
+}
+
+void Server::writerLoop()
+{
+    const int MAX_EVENTS = 256;
+    epoll_event events[MAX_EVENTS];
+
+    while (running)
+    {
+        int n = epoll_wait(writer_epoll_fd, events, MAX_EVENTS, -1);
+        if (n == -1)
+        {
+            if (errno == EINTR) continue;
+            logger::error("✗ epoll_wait: ", strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < n; ++i)
+        {
+            if (events[i].data.u64 == WRITER_WAKE_TAG) continue; // stop() requested
+
+            uint32_t slot = static_cast<uint32_t>(events[i].data.u64 >> 32);
+            int fd = static_cast<int>(events[i].data.u64 & 0xFFFFFFFF);
+
+            ClientRegistry::ReadGuard guard(registry); // Keeps the connection alive while flushing
+            Connection* conn = registry.at(slot);
+            if (conn == nullptr || conn->fd != fd) continue; // Left since the event was raised
 
-            // Log the new connection
-            char clientIP[INET_ADDRSTRLEN];
-            inet_ntop(AF_INET, &client.sin_addr, clientIP, INET_ADDRSTRLEN);
-            std::cout << "✓ New client connected from " << clientIP << std::endl;
-        } else {
-            // No new connection, perform any necessary housekeeping
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            std::lock_guard<std::mutex> lock(conn->out_mutex);
+            if (conn->closed || conn->outq.empty()) continue;
+            if (conn->outq.flush(conn->fd, options.outbound) == OutboundQueue::FlushResult::Error)
+                shutdown(conn->fd, SHUT_RDWR); // The next read task sees the hangup and removes the client
         }
     }
 }
 
-void Server::addMessageToQueue(const std::string& message, int senderSock) {
+std::vector<ClientQueueStats> Server::get_client_queue_stats()
+{
+    std::vector<ClientQueueStats> stats;
+    auto collect = [&stats](const Connection& conn)
+    {
+        stats.push_back({conn.fd, conn.outq.depth(), conn.outq.bytes(), conn.outq.dropped(), conn.outq.behind()});
+    };
+
+    registry.forEach(collect); // Every mode publishes its clients in the registry
+    return stats;
+}
+
+WorkerPoolStats Server::workerStats() const
+{
+    return workers.stats();
+}
+
+std::string Server::metricsText()
+{
+    size_t depthTotal = 0, depthMax = 0, bytesTotal = 0, behind = 0;
+    registry.forEach([&](const Connection& conn) // Gauges are read here, never counted on the hot path
+    {
+        size_t depth = conn.outq.depth();
+        depthTotal += depth;
+        depthMax = std::max(depthMax, depth);
+        bytesTotal += conn.outq.bytes();
+        behind += conn.outq.behind() ? 1 : 0;
+    });
+    ArchiveStats archived = archive.stats();
+    WorkerPoolStats pool = workers.stats();
+    SlabStats slabs = slab::stats();
+
+    std::string text = metrics::snapshot();
+    text += "chat_connections " + std::to_string(registry.size()) + "\n";
+    text += "chat_outbound_queue_depth " + std::to_string(depthTotal) + "\n";
+    text += "chat_outbound_queue_depth_max " + std::to_string(depthMax) + "\n";
+    text += "chat_outbound_queued_bytes " + std::to_string(bytesTotal) + "\n";
+    text += "chat_clients_behind " + std::to_string(behind) + "\n";
+    text += "chat_archive_pending " + std::to_string(archived.pending) + "\n";
+    text += "chat_archive_dropped_total " + std::to_string(archived.dropped) + "\n";
+    text += "chat_slab_reserved_bytes " + std::to_string(slabs.reservedBytes) + "\n";
+    text += "chat_slab_large_allocations_total " + std::to_string(slabs.largeAllocations) + "\n";
+    if (options.mode == ServerMode::Threaded)
+    {
+        text += "chat_worker_threads " + std::to_string(pool.threads) + "\n";
+        text += "chat_worker_tasks_pending " + std::to_string(pool.pending) + "\n";
+        text += "chat_worker_tasks_total " + std::to_string(pool.executed) + "\n";
+        text += "chat_worker_tasks_stolen_total " + std::to_string(pool.stolen) + "\n";
+    }
+    return text;
+}
+
+void Server::addMessageToQueue(const SharedMessage& message) 
+{
+    archive.push(message); // Lock-free, the archive consumer thread drains it in batches
+}
+
+ArchiveStats Server::archiveStats() const 
+{
+    return archive.stats();
+}
+
+void Server::setArchiveSink(ArchiveSink sink) 
+{
+    archive_sink = std::move(sink);
+}
+
+uint32_t Server::registerSession(Connection& conn, std::string_view name)
+{
+    if (conn.session_id != 0 || name.empty() || name.size() > MAX_NICKNAME) return 0; // Once per connection
+    conn.session_id = names.addUser(name);
+    conn.name.assign(name.data(), name.size());
+    logger::info("✓ Session registered: ", name);
+    return conn.session_id;
+}
+
+bool Server::acceptMessage(const Connection& conn, const FrameView& frame, std::string_view& room, std::string_view& text)
+{
+    MessageHeader header;
+    if (conn.session_id == 0 || !parseMessagePayload(frame.payload, header, text)) return false;
+    if (header.sender != conn.session_id) // Only the sender id is checked, the frame is forwarded as is
+    {
+        logger::warn("⚠ Message with a foreign sender id dropped");
+        return false;
+    }
+
+    room = std::string_view();
+    if (header.room == 0) return true;
+    room = names.roomName(header.room);
+    return !room.empty();
+}
+
+bool Server::acceptDirect(const Connection& conn, const FrameView& frame, std::string_view& to, std::string_view& text)
+{
+    MessageHeader header;
+    if (conn.session_id == 0 || !parseDirectPayload(frame.payload, to, header, text)) return false; // Recipients must see who wrote
+    if (header.sender != conn.session_id)
+    {
+        logger::warn("⚠ Direct message with a foreign sender id dropped");
+        return false;
+    }
+    return true;
+}
+
+void Server::initLimits(Connection& conn)
+{
+    uint64_t now = metrics::nowNs();
+    conn.message_bucket.configure(options.limits.clientMessages, options.limits.burst, now);
+    conn.byte_bucket.configure(options.limits.clientBytes, options.limits.burst, now);
+    conn.resume_timer.owner = &conn;
+}
+
+bool Server::admit(Connection& conn, const FrameView& frame)
+{
+    if (!options.limits.any()) return true;
+
+    // Every frame costs a message token and its wire bytes, control frames included: Joins,
+    // Leaves and Pings take locks or produce replies just like chat does
+    std::string_view room = room_limits.enabled() ? roomOf(frame.type, frame.payload) : std::string_view();
+    uint64_t now = metrics::nowNs();
+    double bytes = double(frame.wire.size());
+    uint64_t waitNs = std::max(conn.message_bucket.shortfallNs(1, now), conn.byte_bucket.shortfallNs(bytes, now));
+    if (waitNs == 0 && !room.empty()) waitNs = room_limits.take(room, frame.wire.size(), now); // Takes the room's tokens if it passes
+    if (waitNs == 0)
     {
-        std::lock_guard<std::mutex> lock(queueMutex);
-        messageQueue.push({message, senderSock}); // Add message and sender socket to the queue
+        conn.message_bucket.take(1);
+        conn.byte_bucket.take(bytes);
+        return true;
     }
-    queueCv.notify_one(); // Notify the broadcasting thread
+
+    conn.paused = true; // The caller puts the frame back and stops reading
+    conn.resume_ms = (now + waitNs + 999999) / 1000000 + options.limits.penaltyMs;
+    metrics::add(Counter::Throttled);
+    return false;
 }
 
-void Server::printMessageQueue() {
-    std::cout << "Message Queue Size: " << messageQueue.size() << std::endl;
-    std::queue<std::pair<std::string, int>> tempQueue = messageQueue; // Copy to a temporary queue for printing
+void Server::armHeartbeat(TimingWheel& wheel, Connection& conn)
+{
+    uint64_t now = nowMs();
+    conn.last_heard_ms.store(now, std::memory_order_relaxed);
+    conn.idle_timer.owner = &conn;
+    if (options.heartbeatMs != 0 || options.idleTimeoutMs != 0) checkIdle(wheel, conn, now);
+}
 
-    while (!tempQueue.empty()) 
+Server::Liveness Server::checkIdle(TimingWheel& wheel, Connection& conn, uint64_t now)
+{
+    // Reads only store a timestamp, the timer looks at it when it fires and moves itself
+    // to the next deadline. A busy client costs no wheel operation at all. A rate-limited
+    // client's socket is left unread on purpose, so its Pongs wait in the kernel: it counts
+    // as heard until it resumes. resume_timer lives on this wheel, so reading it here is safe.
+    uint64_t heard = conn.last_heard_ms.load(std::memory_order_relaxed);
+    if (conn.resume_timer.scheduled() && conn.resume_ms > heard)
     {
-        auto& msgPair = tempQueue.front(); // Get the front message
-        std::cout <<  msgPair.first << std::endl;
-        std::cout << "Sender Socket: " << msgPair.second << std::endl;
-        tempQueue.pop(); // Remove the front message
+        heard = conn.resume_ms;
+        conn.last_heard_ms.store(heard, std::memory_order_relaxed);
     }
-}
\ No newline at end of file
+    uint64_t silent = now > heard ? now - heard : 0;
+    if (options.idleTimeoutMs != 0 && silent >= options.idleTimeoutMs) return Liveness::Dead;
+
+    Liveness result = Liveness::Alive;
+    uint64_t next = UINT64_MAX;
+    if (options.heartbeatMs != 0)
+    {
+        if (silent >= options.heartbeatMs) result = Liveness::Ping;
+        next = result == Liveness::Ping ? now + options.heartbeatMs : heard + options.heartbeatMs; // Pings repeat until one is answered
+    }
+    if (options.idleTimeoutMs != 0) next = std::min(next, heard + options.idleTimeoutMs);
+    wheel.schedule(conn.idle_timer, next);
+    return result;
+}
+
+SharedMessage Server::pongFrame(std::string_view payload)
+{
+    char header[FRAME_HEADER_SIZE];
+    encodeFrameHeader(header, FrameType::Pong, payload.size());
+    return SharedMessage::create({std::string_view(header, FRAME_HEADER_SIZE), payload}, FRAME_HEADER_SIZE, -1);
+}
+
+std::string_view Server::roomOf(const SharedMessage& message) const
+{
+    return roomOf(static_cast<FrameType>(message.wire()[4]), message.payload());
+}
+
+std::string_view Server::roomOf(FrameType type, std::string_view payload) const
+{
+    std::string_view room, text;
+    switch (type)
+    {
+    case FrameType::RoomChat:
+        if (parseRoomPayload(payload, room, text)) return room;
+        break;
+    case FrameType::Message:
+    {
+        MessageHeader header;
+        if (parseMessagePayload(payload, header, text) && header.room != 0) return names.roomName(header.room);
+        break;
+    }
+    default: break;
+    }
+    return std::string_view();
+}
+
+SharedMessage Server::welcomeFrame(uint32_t id) const
+{
+    char frame[FRAME_HEADER_SIZE + 2 * MAX_VARINT_SIZE];
+    size_t len = putVarint(frame + FRAME_HEADER_SIZE, id);
+    len += putVarint(frame + FRAME_HEADER_SIZE + len, epoch_ms);
+    encodeFrameHeader(frame, FrameType::Welcome, len);
+    return SharedMessage::create(std::string_view(frame, FRAME_HEADER_SIZE + len), FRAME_HEADER_SIZE, -1);
+}
+
+SharedMessage Server::nameFrame(NameKind kind, uint32_t id, std::string_view name)
+{
+    std::string payload;
+    appendNameEntry(payload, kind, id, name);
+    char header[FRAME_HEADER_SIZE];
+    encodeFrameHeader(header, FrameType::Name, payload.size());
+    return SharedMessage::create({std::string_view(header, FRAME_HEADER_SIZE), payload}, FRAME_HEADER_SIZE, -1);
+}
+
+SharedMessage Server::namesSnapshot() const
+{
+    if (names.users() == 0) return SharedMessage();
+    std::string frames;
+    names.appendSnapshot(frames);
+    return SharedMessage::create(frames, FRAME_HEADER_SIZE, -1); // Several frames in one buffer, written as one
+}
+
+bool Server::startShard(Shard& shard)
+{
+    shard.listening = createListeningSocket(true);
+    if (shard.listening == -1) return false;
+
+    fcntl(shard.listening, F_SETFL, fcntl(shard.listening, F_GETFL, 0) | O_NONBLOCK); // Accept until EAGAIN
+    shard.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    shard.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (shard.epoll_fd == -1 || shard.wake_fd == -1)
+    {
+        logger::error("✗ Can't create epoll instance!");
+        return false;
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = &shard.listening; // Member addresses tag the two non-client fds
+    epoll_ctl(shard.epoll_fd, EPOLL_CTL_ADD, shard.listening, &ev);
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = &shard.wake_fd;
+    epoll_ctl(shard.epoll_fd, EPOLL_CTL_ADD, shard.wake_fd, &ev);
+    return true;
+}
+
+void Server::eventLoop(Shard& shard)
+{
+    const int MAX_EVENTS = 256;
+    epoll_event events[MAX_EVENTS];
+
+    while (running)
+    {
+        int timeout = shard.read_ready.empty() ? shard.timers.timeoutMs(nowMs()) : 0; // -1 unless a client is throttled or heartbeats are on
+        int n = epoll_wait(shard.epoll_fd, events, MAX_EVENTS, timeout);
+        if (n == -1)
+        {
+            if (errno == EINTR) continue;
+            logger::error("✗ epoll_wait: ", strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < n; ++i)
+        {
+            void* tag = events[i].data.ptr;
+            if (tag == &shard.wake_fd) // stop() or another shard posted to the inbox
+            {
+                uint64_t count;
+                ssize_t ignored = read(shard.wake_fd, &count, sizeof(count));
+                (void)ignored;
+                drainInbox(shard);
+                continue;
+            }
+            if (tag == &shard.listening)
+            {
+                acceptReady(shard);
+                continue;
+            }
+
+            Connection* conn = static_cast<Connection*>(tag);
+            if (conn->closed) continue; // Closed earlier in this batch
+
+            if (events[i].events & (EPOLLERR | EPOLLHUP))
+            {
+                logger::warn("⚠ Client disconnected");
+                closeClient(shard, conn);
+                continue;
+            }
+            if (events[i].events & EPOLLIN) scheduleRead(shard, conn); // Read in turn with the other ready clients
+            if (!conn->closed && (events[i].events & EPOLLOUT)) flushClient(shard, conn);
+        }
+
+        readRound(shard);
+
+        uint64_t now = nowMs();
+        shard.timers.advance(now, [this, &shard, now](TimerNode& timer) { fireTimer(shard, timer, now); });
+        reapClosed(shard); // No pending event can reference these anymore
+    }
+
+    reapClosed(shard);
+    for (auto& entry : shard.connections) // Shutdown: close every client the loop still owns
+    {
+        registry.remove(entry.second->registry_slot);
+        metrics::add(Counter::ConnectionsClosed);
+        shutdown(entry.first, SHUT_RDWR);
+        close(entry.first);
+    }
+    shard.connections.clear();
+}
+
+void Server::acceptReady(Shard& shard)
+{
+    while (true)
+    {
+        sockaddr_in client;
+        socklen_t clientSize = sizeof(client);
+        int clientSocket = accept4(shard.listening, (sockaddr*)&client, &clientSize, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+        if (clientSocket == -1)
+        {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                logger::error("✗ accept: ", strerror(errno));
+            return; // Backlog drained
+        }
+
+        auto conn = std::make_unique<Connection>();
+        conn->fd = clientSocket;
+
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET; // Registered once, edges report readiness changes
+        ev.data.ptr = conn.get();
+        if (epoll_ctl(shard.epoll_fd, EPOLL_CTL_ADD, clientSocket, &ev) == -1)
+        {
+            close(clientSocket);
+            continue;
+        }
+        addClient(shard, std::move(conn), client);
+    }
+}
+
+void Server::addClient(Shard& shard, std::unique_ptr<Connection> conn, const sockaddr_in& addr)
+{
+    initLimits(*conn);
+    armHeartbeat(shard.timers, *conn);
+    conn->registry_slot = registry.add(conn.get());
+    metrics::add(Counter::ConnectionsAccepted);
+
+    Connection* added = conn.get();
+    shard.connections[added->fd] = std::move(conn);
+
+    SharedMessage snapshot = namesSnapshot(); // Names before the history using them
+    if (snapshot) added->outq.push(snapshot, options.outbound);
+    if (shard.history.size() != 0 || snapshot) // Replay by reference, written in one writev
+    {
+        shard.history.forEach([&](const SharedMessage& message) { added->outq.push(message, options.outbound); });
+        flushClient(shard, added);
+    }
+
+    char clientIP[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &addr.sin_addr, clientIP, INET_ADDRSTRLEN);
+    logger::info("✓ New client connected from ", clientIP);
+}
+
+void Server::scheduleRead(Shard& shard, Connection* conn)
+{
+    if (conn->read_scheduled || conn->closed) return;
+    conn->read_scheduled = true;
+    shard.read_ready.push_back(conn);
+}
+
+void Server::readRound(Shard& shard)
+{
+    // Deficit round-robin: every ready client gets one quantum of frame bytes per round, and
+    // one that still has input after its turn goes to the back of the line. A client flooding
+    // its socket no longer keeps the loop from everybody else; a quiet one waits one round.
+    shard.read_round.swap(shard.read_ready); // Clients requeued during the round wait for the next one
+    size_t served = 0;
+    for (Connection* conn : shard.read_round)
+    {
+        conn->read_scheduled = false;
+        if (conn->closed || conn->paused) continue; // resumeClient() schedules it again
+        readReady(shard, conn);
+        if (shard.ring && ++served % URING_REAP_BATCH == 0) pumpSends(shard); // Output keeps up with what the round fans out
+    }
+    shard.read_round.clear();
+}
+
+void Server::readReady(Shard& shard, Connection* conn)
+{
+    conn->read_deficit += static_cast<int64_t>(options.readQuantum);
+    decodeFrames(shard, conn); // Held over from the last turn, or (Uring mode) delivered by the kernel since
+
+    while (!shard.ring && !conn->closed && !conn->paused && conn->read_deficit > 0) // Edge-triggered: only EAGAIN ends the turn early
+    {
+        char* buf = conn->decoder.writePtr();
+        ssize_t bytesReceived = recv(conn->fd, buf, conn->decoder.writable(), 0);
+
+        if (bytesReceived > 0)
+        {
+            conn->decoder.commit(static_cast<size_t>(bytesReceived));
+            metrics::add(Counter::BytesIn, bytesReceived);
+            conn->last_heard_ms.store(nowMs(), std::memory_order_relaxed);
+            decodeFrames(shard, conn);
+            continue;
+        }
+
+        if (bytesReceived == -1 && errno == EINTR) continue;
+        if (bytesReceived == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            conn->read_deficit = std::min<int64_t>(conn->read_deficit, 0); // Drained: an idle client saves up no credit
+            return;
+        }
+
+        logger::warn("⚠ Client disconnected");
+        closeClient(shard, conn);
+        return;
+    }
+    if (conn->closed || conn->paused) return;
+
+    if (conn->read_deficit <= 0)
+    {
+        scheduleRead(shard, conn); // Quantum spent with input left: next round
+    }
+    else if (shard.ring) // Uring mode: every complete frame handled, the kernel keeps receiving
+    {
+        conn->read_deficit = 0;
+        if (!conn->recv_armed && conn->decoder.buffered() <= URING_READ_BACKLOG) // Stopped for the backlog: read again
+        {
+            if (!shard.ring->recvMultishot(conn->fd, 0, uringTag(conn, URING_RECV)))
+            {
+                closeClient(shard, conn);
+                return;
+            }
+            conn->recv_armed = true;
+            ++conn->uring_ops;
+        }
+    }
+}
+
+void Server::decodeFrames(Shard& shard, Connection* conn)
+{
+    FrameView frame;
+    FrameDecoder::Status status = FrameDecoder::Status::NeedMore;
+    uint64_t frames = 0;
+    while (!conn->paused && !conn->closed && conn->read_deficit > 0 && (status = conn->decoder.next(frame)) == FrameDecoder::Status::Frame)
+    {
+        if (!handleFrame(shard, conn, frame))
+        {
+            conn->decoder.putBack(frame); // Handled once the client is resumed
+            shard.timers.schedule(conn->resume_timer, conn->resume_ms);
+            cancelRecv(shard, conn); // Stop reading
+            break;
+        }
+        conn->read_deficit -= static_cast<int64_t>(frame.wire.size());
+        ++frames;
+    }
+    metrics::add(Counter::FramesIn, frames);
+
+    if (status == FrameDecoder::Status::Error)
+    {
+        logger::warn("⚠ Client sent an invalid frame, disconnecting");
+        closeClient(shard, conn);
+    }
+}
+
+void Server::resumeClient(Shard& shard, Connection* conn)
+{
+    conn->paused = false;
+    scheduleRead(shard, conn); // Held-back frames first, then the socket: no edge is coming for data that arrived during the pause
+}
+
+void Server::cancelRecv(Shard& shard, Connection* conn)
+{
+    if (!shard.ring || !conn->recv_armed || conn->recv_cancelled) return;
+    shard.ring->cancel(uringTag(conn, URING_RECV), URING_CANCEL);
+    conn->recv_cancelled = true;
+}
+
+void Server::fireTimer(Shard& shard, TimerNode& timer, uint64_t now)
+{
+    Connection* conn = static_cast<Connection*>(timer.owner);
+    if (&timer == &conn->resume_timer)
+    {
+        resumeClient(shard, conn);
+        return;
+    }
+    switch (checkIdle(shard.timers, *conn, now))
+    {
+    case Liveness::Ping:
+        queueTo(shard, conn, ping_frame);
+        metrics::add(Counter::PingsSent);
+        break;
+    case Liveness::Dead:
+        logger::warn("⚠ Client idle for too long, disconnecting");
+        metrics::add(Counter::IdleEvictions);
+        closeClient(shard, conn);
+        break;
+    case Liveness::Alive: break;
+    }
+}
+
+bool Server::handleFrame(Shard& shard, Connection* conn, const FrameView& frame)
+{
+    if (!admit(*conn, frame)) return false;
+
+    switch (frame.type)
+    {
+    case FrameType::Chat:
+        logger::sample(LogLevel::Info, "✉  ", frame.payload); // Rate-limited by --log-sample
+        broadcastEpoll(shard, frame, conn->fd);
+        break;
+    case FrameType::Join: joinRoomEpoll(shard, conn, frame.payload); break;
+    case FrameType::Leave: leaveRoomEpoll(shard, conn, frame.payload); break;
+    case FrameType::RoomChat:
+    {
+        std::string_view room, text;
+        if (!parseRoomPayload(frame.payload, room, text)) break;
+        broadcastEpoll(shard, frame, conn->fd); // Same path, fanOut picks the members
+        break;
+    }
+    case FrameType::Hello: helloEpoll(shard, conn, frame.payload); break;
+    case FrameType::Ping: queueTo(shard, conn, pongFrame(frame.payload)); break;
+    case FrameType::Direct:
+        directEpoll(shard, conn, frame);
+        break;
+    case FrameType::Message:
+    {
+        std::string_view room, text;
+        if (!acceptMessage(*conn, frame, room, text)) break;
+        logger::sample(LogLevel::Info, "✉  ", text);
+        broadcastEpoll(shard, frame, conn->fd);
+        break;
+    }
+    default: break; // Unknown types are ignored
+    }
+    return true;
+}
+
+void Server::flushClient(Shard& shard, Connection* conn)
+{
+    if (shard.ring) // Uring mode: batched with every other client's output at the end of the loop iteration
+    {
+        if (!conn->send_scheduled && !conn->sending)
+        {
+            conn->send_scheduled = true;
+            shard.send_ready.push_back(conn);
+        }
+        return;
+    }
+
+    if (conn->outq.flush(conn->fd, options.outbound) == OutboundQueue::FlushResult::Error)
+    {
+        conn->outq.clear();
+        closeClient(shard, conn);
+    }
+    // Blocked: the EPOLLOUT edge raised once the socket drains resumes the flush
+}
+
+void Server::closeClient(Shard& shard, Connection* conn)
+{
+    if (conn->closed) return;
+    conn->closed = true;
+    shard.timers.cancel(conn->resume_timer); // Freed by reapClosed(), the wheel must not fire for it
+    shard.timers.cancel(conn->idle_timer);
+
+    if (shard.epoll_fd != -1) epoll_ctl(shard.epoll_fd, EPOLL_CTL_DEL, conn->fd, nullptr);
+    shutdown(conn->fd, SHUT_RDWR); // Also ends the io_uring requests still pending on it
+    shard.closed_fds.push_back(conn->fd); // close() waits for the batch end so the fd number can't be reused mid-batch
+
+    registry.remove(conn->registry_slot); // Stats readers are done with it once this returns
+    metrics::add(Counter::ConnectionsClosed);
+    conn->registry_slot = ClientRegistry::NO_SLOT;
+}
+
+void Server::reapClosed(Shard& shard)
+{
+    for (size_t i = 0; i < shard.closed_fds.size(); ++i) // Announcing a departure can close more slow clients
+    {
+        int fd = shard.closed_fds[i];
+        Connection* conn = shard.connections[fd].get();
+        while (!conn->rooms.empty()) leaveRoomEpoll(shard, conn, std::string(conn->rooms.back()));
+        if (conn->session_id != 0)
+        {
+            directory.remove(conn->name, conn->session_id);
+            shard.sessions.erase(conn->session_id);
+            names.removeUser(conn->session_id);
+            announceEpoll(shard, nameFrame(NameKind::User, conn->session_id, std::string_view()));
+        }
+        if (conn->send_scheduled) shard.send_ready.erase(std::find(shard.send_ready.begin(), shard.send_ready.end(), conn));
+        if (conn->read_scheduled) shard.read_ready.erase(std::find(shard.read_ready.begin(), shard.read_ready.end(), conn));
+        auto it = shard.connections.find(fd);
+        if (conn->uring_ops > 0) shard.retired.push_back(std::move(it->second)); // Freed once the kernel is done with it
+        shard.connections.erase(it);
+        close(fd);
+    }
+    shard.closed_fds.clear();
+}
+
+void Server::broadcastEpoll(Shard& shard, const FrameView& frame, int senderSock)
+{
+    SharedMessage message = SharedMessage::create(frame.wire, FRAME_HEADER_SIZE, senderSock); // The only copy
+    metrics::add(Counter::MessagesBroadcast);
+    fanOut(shard, message);
+
+    for (auto& other : shards) // Every other shard gets a reference, no shared lock on the way
+    {
+        if (other.get() == &shard) continue;
+        postToShard(*other, new InboundMessage{message});
+    }
+
+    addMessageToQueue(message);
+}
+
+void Server::fanOut(Shard& shard, const SharedMessage& message)
+{
+    if (static_cast<FrameType>(message.wire()[4]) == FrameType::Name) // Announcement: everyone, not kept in history
+    {
+        for (auto& entry : shard.connections) queueTo(shard, entry.second.get(), message);
+        return;
+    }
+
+    std::string_view room = roomOf(message);
+    if (!room.empty())
+    {
+        fanOutRoom(shard, message, room);
+        return;
+    }
+
+    shard.history.push(message);
+    uint64_t deliveries = 0;
+    for (auto& entry : shard.connections) // Shard thread owns the map, no lock needed
+    {
+        deliveries += queueTo(shard, entry.second.get(), message);
+    }
+    metrics::add(Counter::Deliveries, deliveries);
+}
+
+void Server::fanOutRoom(Shard& shard, const SharedMessage& message, std::string_view room)
+{
+    thread_local std::string key; // One per shard thread, reused by every room fan-out
+    key.assign(room.data(), room.size());
+    auto it = shard.rooms.find(key);
+    if (it == shard.rooms.end()) return; // No member on this shard
+
+    uint64_t deliveries = 0;
+    for (Connection* conn : it->second) deliveries += queueTo(shard, conn, message); // Closed members stay listed until reapClosed()
+    metrics::add(Counter::Deliveries, deliveries);
+}
+
+bool Server::queueTo(Shard& shard, Connection* conn, const SharedMessage& message)
+{
+    if (conn->fd == message.senderSock() || conn->closed) return false;
+
+    bool idle = conn->outq.empty();
+    OutboundQueue::PushResult result = conn->outq.push(message, options.outbound);
+
+    if (result == OutboundQueue::PushResult::Overflow) // Disconnect policy
+    {
+        logger::warn("⚠ Disconnecting slow client");
+        metrics::add(Counter::SlowDisconnects);
+        closeClient(shard, conn);
+    }
+    else if (result == OutboundQueue::PushResult::Queued && idle)
+    {
+        flushClient(shard, conn); // Otherwise an EPOLLOUT edge is already pending
+    }
+    return true;
+}
+
+void Server::helloEpoll(Shard& shard, Connection* conn, std::string_view name)
+{
+    uint32_t id = registerSession(*conn, name);
+    if (id == 0) return;
+
+    shard.sessions[id] = conn;
+    directory.add(name, DirectoryEntry{nullptr, id, shard.index});
+    queueTo(shard, conn, welcomeFrame(id));
+    announceEpoll(shard, nameFrame(NameKind::User, id, name)); // The new client included: it learns its own name like any other
+}
+
+void Server::announceEpoll(Shard& shard, const SharedMessage& message)
+{
+    fanOut(shard, message);
+    for (auto& other : shards)
+    {
+        if (other.get() != &shard) postToShard(*other, new InboundMessage{message});
+    }
+}
+
+void Server::directEpoll(Shard& shard, Connection* conn, const FrameView& frame)
+{
+    std::string_view to, text;
+    if (!acceptDirect(*conn, frame, to, text)) return;
+
+    SharedMessage message = SharedMessage::create(frame.wire, FRAME_HEADER_SIZE, conn->fd); // Forwarded verbatim
+    size_t recipients = directory.forEach(to, [&](const DirectoryEntry& entry)
+    {
+        if (entry.shard == shard.index) deliverDirect(shard, entry.sessionId, message);
+        else postToShard(*shards[entry.shard], new InboundMessage{message, nullptr, entry.sessionId}); // Its owner queues it
+    });
+    metrics::add(recipients != 0 ? Counter::DirectMessages : Counter::DirectUndeliverable);
+
+    addMessageToQueue(message);
+}
+
+void Server::deliverDirect(Shard& shard, uint32_t target, const SharedMessage& message)
+{
+    auto it = shard.sessions.find(target);
+    if (it == shard.sessions.end()) return; // Left before the message got here
+    metrics::add(Counter::Deliveries, queueTo(shard, it->second, message));
+}
+
+void Server::joinRoomEpoll(Shard& shard, Connection* conn, std::string_view room)
+{
+    if (room.empty() || room.size() > MAX_ROOM_NAME) return;
+    uint32_t id = conn->session_id != 0 ? names.internRoom(room) : 0; // Interned only as it gets a member
+    if (conn->session_id != 0 && id == 0)
+    {
+        logger::warn("⚠ Room table full, join refused");
+        return;
+    }
+    if (id != 0) queueTo(shard, conn, nameFrame(NameKind::Room, id, room)); // Room id for its Message frames
+    if (std::find(conn->rooms.begin(), conn->rooms.end(), room) != conn->rooms.end()) return;
+
+    shard.rooms[std::string(room)].push_back(conn);
+    conn->rooms.emplace_back(room);
+}
+
+void Server::leaveRoomEpoll(Shard& shard, Connection* conn, std::string_view room)
+{
+    auto joined = std::find(conn->rooms.begin(), conn->rooms.end(), room);
+    if (joined == conn->rooms.end()) return;
+
+    auto it = shard.rooms.find(*joined);
+    std::vector<Connection*>& members = it->second;
+    *std::find(members.begin(), members.end(), conn) = members.back();
+    members.pop_back();
+    if (members.empty()) shard.rooms.erase(it);
+
+    conn->rooms.erase(joined);
+}
+
+void Server::postToShard(Shard& shard, InboundMessage* msg)
+{
+    InboundMessage* head = shard.inbox.load(std::memory_order_relaxed);
+    do
+    {
+        msg->next = head;
+    } while (!shard.inbox.compare_exchange_weak(head, msg, std::memory_order_release, std::memory_order_relaxed));
+
+    if (head == nullptr) // Inbox was empty: the owner may be asleep in epoll_wait
+    {
+        uint64_t one = 1;
+        ssize_t ignored = write(shard.wake_fd, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+void Server::drainInbox(Shard& shard)
+{
+    InboundMessage* msg = shard.inbox.exchange(nullptr, std::memory_order_acquire); // Take the whole batch at once
+
+    InboundMessage* ordered = nullptr; // The inbox is LIFO, reverse to keep per-sender order
+    while (msg != nullptr)
+    {
+        InboundMessage* next = msg->next;
+        msg->next = ordered;
+        ordered = msg;
+        msg = next;
+    }
+
+    unsigned handled = 0;
+    while (ordered != nullptr)
+    {
+        InboundMessage* next = ordered->next;
+        if (ordered->target != 0) deliverDirect(shard, ordered->target, ordered->message);
+        else fanOut(shard, ordered->message);
+        delete ordered;
+        ordered = next;
+        if (shard.ring && ++handled % URING_REAP_BATCH == 0) pumpSends(shard); // Uring mode: write as we go, like epoll mode does
+    }
+}
+
+bool Server::startUringShard(Shard& shard)
+{
+    shard.listening = createListeningSocket(true);
+    if (shard.listening == -1) return false;
+
+    shard.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    shard.ring = std::make_unique<Uring>();
+    if (shard.wake_fd == -1 || !shard.ring->init(URING_ENTRIES) || !shard.ring->setupBuffers(0, URING_BUFFERS, URING_BUFFER_SIZE))
+    {
+        logger::error("✗ Can't create io_uring instance: ", strerror(errno));
+        return false;
+    }
+
+    shard.completions.reserve(4 * URING_ENTRIES); // A full completion ring, so the loop never grows it
+    shard.ring->acceptMultishot(shard.listening, URING_ACCEPT, SOCK_NONBLOCK | SOCK_CLOEXEC); // Submitted by the loop's first enter
+    shard.ring->pollMultishot(shard.wake_fd, URING_WAKE);
+    return true;
+}
+
+void Server::uringLoop(Shard& shard)
+{
+    Uring& ring = *shard.ring;
+    auto complete = [this, &shard](const io_uring_cqe& cqe) { completeUring(shard, cqe); };
+
+    while (running)
+    {
+        int timeout = shard.read_ready.empty() ? shard.timers.timeoutMs(nowMs()) : 0; // Clients with input left: just look for completions
+        int result = ring.submit(1, timeout); // Everything prepared since the last wait goes out in this one syscall
+        if (result < 0 && result != -EINTR && result != -EBUSY && result != -EAGAIN && result != -ETIME) // EBUSY: completions to reap first
+        {
+            logger::error("✗ io_uring_enter: ", strerror(-result));
+            break;
+        }
+
+        // A fast sender can queue hundreds of reads ahead of the send completions that free
+        // output space, so reads are handled in small batches, each followed by pumpSends().
+        shard.completions.clear();
+        ring.reap([this, &shard](const io_uring_cqe& cqe) { collectUring(shard, cqe); });
+        size_t done = 0;
+        auto handleCompletions = [&]()
+        {
+            while (done < shard.completions.size())
+            {
+                size_t end = std::min(done + URING_REAP_BATCH, shard.completions.size());
+                for (; done < end; ++done)
+                {
+                    io_uring_cqe cqe = shard.completions[done]; // A wake drains the inbox, whose pumpSends() may grow the vector
+                    completeUring(shard, cqe);
+                }
+                reapClosed(shard);
+                pumpSends(shard);
+            }
+        };
+        handleCompletions();
+        readRound(shard);
+        handleCompletions(); // Reaped while the round pumped its output, their reads wait for the next round
+        uint64_t now = nowMs();
+        shard.timers.advance(now, [this, &shard, now](TimerNode& timer) { fireTimer(shard, timer, now); });
+        reapClosed(shard);
+        submitSends(shard); // Departures' announcements go out with the next wait
+        shard.retired.erase(std::remove_if(shard.retired.begin(), shard.retired.end(),
+                                           [](const std::unique_ptr<Connection>& conn) { return conn->uring_ops == 0; }),
+                            shard.retired.end());
+    }
+
+    reapClosed(shard);
+    for (auto& entry : shard.connections) // Shutdown: end every client's requests...
+    {
+        registry.remove(entry.second->registry_slot);
+        metrics::add(Counter::ConnectionsClosed);
+        entry.second->closed = true;
+        shutdown(entry.first, SHUT_RDWR);
+    }
+
+    auto inFlight = [&shard]()
+    {
+        size_t ops = 0;
+        for (auto& entry : shard.connections) ops += entry.second->uring_ops;
+        for (auto& conn : shard.retired) ops += conn->uring_ops;
+        return ops;
+    };
+    while (inFlight() > 0) // ...and wait for them, the kernel may still read their output buffers
+    {
+        int result = ring.submit(1);
+        if (result < 0 && result != -EINTR && result != -EBUSY && result != -EAGAIN) break;
+        ring.reap(complete);
+    }
+
+    for (auto& entry : shard.connections) close(entry.first);
+    shard.connections.clear();
+    shard.retired.clear();
+}
+
+void Server::collectUring(Shard& shard, const io_uring_cqe& cqe)
+{
+    if ((cqe.user_data & URING_KIND_MASK) == URING_SEND) completeUring(shard, cqe); // Frees output space right away
+    else shard.completions.push_back(cqe); // Provided buffers stay ours until recycled
+}
+
+void Server::pumpSends(Shard& shard)
+{
+    submitSends(shard);
+    if (shard.ring->pending() > 0) shard.ring->submit(); // Sends to a socket with room complete inline
+    shard.ring->reap([this, &shard](const io_uring_cqe& cqe) { collectUring(shard, cqe); });
+}
+
+void Server::completeUring(Shard& shard, const io_uring_cqe& cqe)
+{
+    Uring& ring = *shard.ring;
+    uint64_t kind = cqe.user_data & URING_KIND_MASK;
+    bool more = cqe.flags & IORING_CQE_F_MORE; // Multishot request still armed
+
+    if (kind == URING_WAKE) // stop() or another shard posted to the inbox
+    {
+        uint64_t count;
+        ssize_t ignored = read(shard.wake_fd, &count, sizeof(count));
+        (void)ignored;
+        drainInbox(shard);
+        if (!more) ring.pollMultishot(shard.wake_fd, URING_WAKE);
+        return;
+    }
+    if (kind == URING_CANCEL) return; // The cancelled recv reports on its own
+
+    if (kind == URING_ACCEPT)
+    {
+        if (cqe.res >= 0 && !running)
+        {
+            close(cqe.res);
+        }
+        else if (cqe.res >= 0)
+        {
+            auto conn = std::make_unique<Connection>();
+            conn->fd = cqe.res;
+            sockaddr_in client{};
+            socklen_t clientSize = sizeof(client);
+            getpeername(cqe.res, (sockaddr*)&client, &clientSize);
+
+            Connection* added = conn.get();
+            addClient(shard, std::move(conn), client);
+            if (ring.recvMultishot(added->fd, 0, uringTag(added, URING_RECV)))
+            {
+                ++added->uring_ops;
+                added->recv_armed = true;
+            }
+            else
+            {
+                closeClient(shard, added);
+            }
+        }
+        else if (cqe.res != -ECONNABORTED && cqe.res != -EINTR)
+        {
+            logger::error("✗ accept: ", strerror(-cqe.res));
+        }
+        if (!more && running) ring.acceptMultishot(shard.listening, URING_ACCEPT, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        return;
+    }
+
+    Connection* conn = reinterpret_cast<Connection*>(cqe.user_data & ~URING_KIND_MASK);
+    if (kind == URING_RECV)
+    {
+        if (cqe.flags & IORING_CQE_F_BUFFER)
+        {
+            uint16_t id = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+            if (cqe.res > 0 && !conn->closed) // Copied into the decoder, so the buffer goes straight back
+            {
+                size_t size = static_cast<size_t>(cqe.res);
+                char* buf = conn->decoder.writePtr(size);
+                std::memcpy(buf, ring.buffer(id), size);
+                conn->decoder.commit(size);
+                metrics::add(Counter::BytesIn, size);
+                conn->last_heard_ms.store(nowMs(), std::memory_order_relaxed);
+                if (!conn->paused) scheduleRead(shard, conn); // Handled in the read round, in turn with the others
+                if (conn->decoder.buffered() > URING_READ_BACKLOG) cancelRecv(shard, conn); // Further ahead than its turns: stop receiving
+            }
+            ring.recycle(id);
+        }
+        if (more) return;
+
+        --conn->uring_ops;
+        conn->recv_armed = false;
+        conn->recv_cancelled = false;
+        if (conn->closed) return;
+        if (cqe.res != 0 && (conn->paused || conn->decoder.buffered() > URING_READ_BACKLOG)) return; // readReady() arms it again
+        if (cqe.res == 0 && !conn->paused) // The client's last frames may still wait for their turn
+        {
+            conn->read_deficit = INT64_MAX / 2;
+            decodeFrames(shard, conn);
+            if (conn->closed) return;
+        }
+        if (cqe.res > 0 || cqe.res == -ENOBUFS || cqe.res == -ECANCELED) // Ended by the kernel (e.g. out of buffers) or by us, not by the client
+        {
+            if (ring.recvMultishot(conn->fd, 0, uringTag(conn, URING_RECV)))
+            {
+                ++conn->uring_ops;
+                conn->recv_armed = true;
+                return;
+            }
+        }
+        logger::warn("⚠ Client disconnected");
+        closeClient(shard, conn);
+        return;
+    }
+
+    --conn->uring_ops; // URING_SEND
+    conn->sending = false;
+    if (cqe.res < 0)
+    {
+        conn->outq.consume(0, options.outbound);
+        if (conn->closed) return;
+        conn->outq.clear();
+        closeClient(shard, conn);
+        return;
+    }
+    conn->outq.consume(static_cast<size_t>(cqe.res), options.outbound);
+    if (!conn->closed && !conn->outq.empty()) flushClient(shard, conn); // Partial write or output queued meanwhile
+}
+
+void Server::submitSends(Shard& shard)
+{
+    std::vector<Connection*> ready;
+    ready.swap(shard.send_ready);
+
+    for (Connection* conn : ready)
+    {
+        conn->send_scheduled = false;
+        if (conn->closed || conn->sending || conn->outq.empty()) continue;
+
+        if (!conn->send_iov) conn->send_iov.reset(new iovec[OutboundQueue::FLUSH_BATCH]);
+        conn->send_msg = msghdr{};
+        conn->send_msg.msg_iov = conn->send_iov.get();
+        conn->send_msg.msg_iovlen = conn->outq.gather(conn->send_iov.get(), OutboundQueue::FLUSH_BATCH);
+
+        if (!shard.ring->sendmsg(conn->fd, &conn->send_msg, uringTag(conn, URING_SEND)))
+        {
+            conn->outq.consume(0, options.outbound); // Submission ring still full: retry next iteration
+            flushClient(shard, conn);
+            continue;
+        }
+        conn->sending = true;
+        ++conn->uring_ops;
+    }
+
+    ready.clear();
+    if (shard.send_ready.empty()) shard.send_ready.swap(ready); // Keep the capacity
+}
@@ -2,37 +2,262 @@
 #include <string>
 #include <mutex>
 #include <thread>
-#include <queue>
-#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <netinet/in.h>
+#include "frame.h"
+#include "message_buffer.h"
+#include "slab_pool.h"
+#include "outbound_queue.h"
+#include "client_registry.h"
+#include "archive.h"
+#include "message_log.h"
+#include "history_ring.h"
+#include "room_table.h"
+#include "name_table.h"
+#include "user_directory.h"
+#include "worker_pool.h"
+#include "uring.h"
+#include "rate_limiter.h"
+#include "timing_wheel.h"
+#include "metrics.h"
+
+enum class ServerMode
+{
+    Threaded, // A dispatcher thread hands readable clients to a fixed worker pool
+    Epoll,    // Edge-triggered epoll loops (shards) owning every socket (non-blocking)
+    Uring     // Shards driven by io_uring: multishot accept/recv into provided buffers, batched sends. Falls back to Epoll
+};
+
+struct ServerOptions
+{
+    ServerMode mode = ServerMode::Threaded; // I/O model used by start(), see Server::mode() for the one running
+    size_t workers = 0; // Worker threads serving client sockets (Threaded mode), 0 means one per hardware thread
+    int shards = 1; // Number of event loops, each with its own SO_REUSEPORT listener (Epoll and Uring modes)
+    OutboundLimits outbound; // Per-client outbound queue watermarks and slow-consumer policy
+    ArchiveOptions archive; // Capacity, batch size and overflow policy of the archive ring
+    MessageLogOptions log; // Persistent message log, disabled while log.directory is empty
+    size_t history = 50; // Recent messages replayed to every new client, 0 disables
+    size_t maxRooms = 65536; // Room names interned for handshaken clients over the server's lifetime, Joins beyond are refused
+    int adminPort = 0; // Local port serving a metrics snapshot, 0 disables
+    RateLimits limits; // Per-client and per-room message/byte rates, unlimited by default
+    uint32_t heartbeatMs = 0; // Ping a client that has sent nothing for this long, 0 never pings
+    uint32_t idleTimeoutMs = 0; // Disconnect a client that has sent nothing for this long, 0 keeps it forever
+    size_t readQuantum = 16 * 1024; // Frame bytes handled per client and scheduling round (deficit round-robin), at least 1
+};
+
+struct ClientQueueStats // Snapshot of one client's outbound queue
+{
+    int fd; // Client socket
+    size_t depth; // Messages waiting to be written
+    size_t bytes; // Bytes waiting to be written
+    uint64_t dropped; // Messages dropped by the slow-consumer policy
+    bool behind; // Above the high watermark and not yet drained below the low one
+};
+
+struct Connection // Per-client state, owned by one epoll loop or by the pool task currently serving it
+{
+    int fd = -1; // Client socket
+    FrameDecoder decoder; // Reassembles frames across partial reads
+    OutboundQueue outq; // Bounded queue of shared messages accepted for sending but not yet written
+    std::mutex out_mutex; // Threaded mode: serializes broadcasters, the writer thread and removal
+    uint32_t registry_slot = ClientRegistry::NO_SLOT; // Position in Server::registry
+    uint64_t history_cutoff = 0; // Threaded mode: last history sequence already queued at accept
+    std::vector<std::string> rooms; // Rooms joined, left again on disconnect (owner only)
+    uint32_t session_id = 0; // Assigned by the Hello handshake, 0 for clients that never sent one
+    std::string name; // Nickname from the handshake, the key of its UserDirectory entry
+    int uring_ops = 0; // Uring mode: requests in flight for this client, it is freed once they completed
+    bool send_scheduled = false; // Uring mode: listed in Shard::send_ready
+    bool sending = false; // Uring mode: a SENDMSG is in flight, described by send_msg/send_iov
+    msghdr send_msg{};
+    std::unique_ptr<iovec[]> send_iov; // OutboundQueue::FLUSH_BATCH entries, allocated on the first send
+    bool recv_armed = false; // Uring mode: a multishot recv is active
+    bool recv_cancelled = false; // Uring mode: the active recv is being cancelled (throttled or backlogged)
+    int64_t read_deficit = 0; // Fair reads: frame bytes left in this round, negative after a frame larger than the rest
+    bool read_scheduled = false; // Epoll/Uring mode: listed in Shard::read_ready
+    TokenBucket message_bucket; // Rate limits: messages this client may still send
+    TokenBucket byte_bucket; // Rate limits: frame bytes this client may still send
+    TimerNode resume_timer; // Rate limits: fires when a throttled client may be read again
+    uint64_t resume_ms = 0; // Rate limits: when resume_timer should fire
+    bool paused = false; // Rate limited: its socket is not read until resume_timer fires
+    TimerNode idle_timer; // Heartbeats: next ping or idle timeout check
+    std::atomic<uint64_t> last_heard_ms{0}; // Heartbeats: last read from the client (written by readers, checked on idle_timer)
+    bool closed = false; // Set once the client is dropped
+};
+
+struct InboundMessage // Broadcast handed from the shard that received it to another shard
+{
+    SharedMessage message; // Framed message, shared by every shard it is posted to
+    InboundMessage* next = nullptr; // Intrusive link for the shard inbox
+    uint32_t target = 0; // Direct message: recipient's session id on the receiving shard, 0 for a fan-out
+
+    static void* operator new(size_t size) { return slab::allocate(size); } // One per message and shard, pooled
+    static void operator delete(void* p, size_t size) { slab::release(p, size); }
+};
+
+struct Shard // One event loop: its own listening socket, epoll instance (or io_uring) and client set
+{
+    int index = 0; // Position in Server::shards
+    int listening = -1; // SO_REUSEPORT listening socket, the kernel spreads accepts across shards
+    int epoll_fd = -1; // Epoll instance
+    int wake_fd = -1; // Eventfd signalled by stop() and by other shards posting to the inbox
+    std::thread thread; // Thread running Server::eventLoop() for this shard
+    std::unordered_map<int, std::unique_ptr<Connection>> connections; // Client state by socket (shard thread only)
+    std::vector<int> closed_fds; // Clients dropped during the current event batch
+    std::atomic<InboundMessage*> inbox{nullptr}; // Lock-free LIFO of messages posted by other shards
+    HistoryRing history{0}; // Recent messages seen by this shard, replayed to its new clients
+    std::unordered_map<std::string, std::vector<Connection*>> rooms; // This shard's members of each room (shard thread only)
+    std::unordered_map<uint32_t, Connection*> sessions; // Handshaken clients by session id, for direct messages (shard thread only)
+    std::unique_ptr<Uring> ring; // Uring mode: replaces epoll_fd
+    std::vector<Connection*> read_ready; // Clients with input left, each served one quantum per round in this order
+    std::vector<Connection*> read_round; // The round being served, swapped with read_ready so both keep their capacity
+    std::vector<Connection*> send_ready; // Uring mode: clients whose output is submitted at the end of the batch
+    std::vector<std::unique_ptr<Connection>> retired; // Uring mode: closed clients the kernel still holds requests for
+    std::vector<io_uring_cqe> completions; // Uring mode: reaped reads, accepts and wakes not yet handled
+    TimingWheel timers{metrics::nowNs() / 1000000}; // Throttled clients' resume times and idle timers (shard thread only)
+};
 
 class Server {
 public:
-    Server(int port); // Constructor
+    Server(int port, const ServerOptions& options = ServerOptions()); // Constructor
     ~Server(); // Destructor
 
     void start(); // Start the server | Open to connections
-    void stop(); // Stop the server | Close all connections  
+    void stop(); // Stop the server | Close all connections
 
     int get_connection_count(); /// Find number of active clients
+    ServerMode mode() const { return options.mode; } // Mode in use, Epoll after a Uring fallback
+    std::vector<ClientQueueStats> get_client_queue_stats(); // Outbound queue depth and drops of every client
 
-    void remove_client(int clientSock); // Remove a client from the list   
-    void handleClient(int clientSock); // Handle communication with a client
-    void broadcast(const std::string& message, int senderSock); // Display one client's message to other clients 
-    void acceptClients(); // Accept incoming client connections
+    void remove_client(Connection& conn); // Remove a client from the registry and close its socket
+    void broadcast(const FrameView& frame, int senderSock); // Display one client's message to other clients
+    void joinRoom(Connection& conn, std::string_view room); // Subscribe a client to a room
+    void leaveRoom(Connection& conn, std::string_view room); // Unsubscribe a client from a room
+    void broadcastRoom(const FrameView& frame, std::string_view room, int senderSock); // Forward a room message to the room's members only
 
-    void addMessageToQueue(const std::string& message, int senderSock); // Add message to the queue for broadcasting
-    void printMessageQueue(); // Print the message queue (for debugging)
-    bool running; // Server running status
+    void addMessageToQueue(const SharedMessage& message); // Add message to the archive ring (shares the buffer)
+    ArchiveStats archiveStats() const; // Archive counters: enqueued, archived, dropped, pending
+    void setArchiveSink(ArchiveSink sink); // Receive archived batches as views (call before start())
+    std::string metricsText(); // Metrics snapshot plus live gauges, as served on the admin port
+    WorkerPoolStats workerStats() const; // Threaded mode: pool size and task counters
+    std::atomic<bool> running; // Server running status
 
 private:
-    int port; // Port number            
-    int listening; // Listening socket
-    
-    std::queue<std::pair<std::string, int>> messageQueue; // Queue for messages to broadcast
-    std::mutex queueMutex; // Mutex for thread-safe queue access
-    std::condition_variable queueCv; // Condition variable for message notification
-
-    std::vector<int> client_sockets; // List of active client sockets
-    std::vector<std::thread> client_threads; // Threads representing each client connection
-    std::mutex clients_mutex; // Mutex for thread-safe access to client_sockets   
+    int createListeningSocket(bool reusePort); // Socket bound to 0.0.0.0:port and listening, -1 on failure
+
+    // ===== Session handshake =====
+    uint32_t registerSession(Connection& conn, std::string_view name); // Hello: assign an id, 0 if refused
+    bool acceptMessage(const Connection& conn, const FrameView& frame, std::string_view& room, std::string_view& text); // Validate a Message frame
+    bool acceptDirect(const Connection& conn, const FrameView& frame, std::string_view& to, std::string_view& text); // Validate a Direct frame
+    std::string_view roomOf(const SharedMessage& message) const; // Room a RoomChat or Message frame is sent to, empty for everyone
+    std::string_view roomOf(FrameType type, std::string_view payload) const; // Same, for a frame still in the decoder
+    SharedMessage welcomeFrame(uint32_t id) const; // Welcome reply for a new session
+    static SharedMessage nameFrame(NameKind kind, uint32_t id, std::string_view name); // One Name entry
+    SharedMessage namesSnapshot() const; // Name frames for every current user, empty handle if none
+    // =============================
+
+    // ===== Rate limits =====
+    void initLimits(Connection& conn); // Fill a new client's token buckets
+    bool admit(Connection& conn, const FrameView& frame); // Take tokens for any frame, or pause the client (false)
+    // =======================
+
+    // ===== Heartbeats =====
+    enum class Liveness { Alive, Ping, Dead };
+    void armHeartbeat(TimingWheel& wheel, Connection& conn); // Start a new client's idle timer, if heartbeats are on
+    Liveness checkIdle(TimingWheel& wheel, Connection& conn, uint64_t nowMs); // Idle timer fired: re-arm it, say what to do
+    static SharedMessage pongFrame(std::string_view payload); // Reply to a client's Ping
+    // ======================
+
+    // ===== Threaded mode =====
+    void dispatchLoop(); // Accept clients and hand every readable socket to the worker pool
+    void acceptClients(); // Accept every pending connection (non-blocking listener)
+    void handleClient(Connection* conn); // Pool task: one quantum of the client's input, then requeue, re-arm, park or remove it
+    bool processFrames(Connection& conn); // Act on complete frames until paused or out of quantum, false on an invalid frame
+    bool handleFrame(Connection& conn, const FrameView& frame); // Act on one frame, false if the rate limit held it back
+    void pauseClient(Connection& conn); // Park a throttled client on the dispatcher's timing wheel
+    void deliver(Connection& conn, const SharedMessage& message); // Queue for one client and try a non-blocking flush
+    void writerLoop(); // Flush backlogged clients when their sockets become writable
+    void hello(Connection& conn, std::string_view name); // Handshake, then announce the name to everyone
+    void announce(const SharedMessage& message); // Queue a Name frame for every client
+    void direct(Connection& conn, const FrameView& frame); // Route a Direct frame to the recipient's connections
+    // =========================
+
+    // ===== Epoll mode =====
+    bool startShard(Shard& shard); // Create the shard's listener, epoll instance and eventfd
+    void eventLoop(Shard& shard); // Wait for readiness events and dispatch them until stopped
+    void acceptReady(Shard& shard); // Accept every pending connection (edge-triggered)
+    void addClient(Shard& shard, std::unique_ptr<Connection> conn, const sockaddr_in& addr); // Register an accepted client, replay history
+    void scheduleRead(Shard& shard, Connection* conn); // Queue a client with input for the next read round
+    void readRound(Shard& shard); // Serve every ready client one quantum, in turn
+    void readReady(Shard& shard, Connection* conn); // One client's turn: its held-over frames, then the socket until the quantum is spent
+    void decodeFrames(Shard& shard, Connection* conn); // Act on the complete frames received so far, until paused or out of quantum
+    void resumeClient(Shard& shard, Connection* conn); // Timer fired: act on the held-back frames and read again
+    void cancelRecv(Shard& shard, Connection* conn); // Uring mode: stop the client's multishot recv (once)
+    void fireTimer(Shard& shard, TimerNode& timer, uint64_t nowMs); // Resume a throttled client or check an idle one
+    void flushClient(Shard& shard, Connection* conn); // Write as much of the pending output as the socket takes
+    void closeClient(Shard& shard, Connection* conn); // Unregister a client, its socket is closed by reapClosed()
+    void reapClosed(Shard& shard); // Close and free every client dropped during the current event batch
+    bool handleFrame(Shard& shard, Connection* conn, const FrameView& frame); // Act on one decoded frame, false if the rate limit held it back
+    void broadcastEpoll(Shard& shard, const FrameView& frame, int senderSock); // Fan-out locally and post to the other shards
+    void fanOut(Shard& shard, const SharedMessage& message); // Queue a reference to the message for every client of one shard
+    void fanOutRoom(Shard& shard, const SharedMessage& message, std::string_view room); // Queue a room message for this shard's room members
+    bool queueTo(Shard& shard, Connection* conn, const SharedMessage& message); // Push to one client and start a flush if idle, false if skipped
+    void helloEpoll(Shard& shard, Connection* conn, std::string_view name); // Handshake, then announce the name to every shard
+    void announceEpoll(Shard& shard, const SharedMessage& message); // Fan-out a Name frame here and post it to the other shards
+    void directEpoll(Shard& shard, Connection* conn, const FrameView& frame); // Queue locally or post to the recipient's shard
+    void deliverDirect(Shard& shard, uint32_t target, const SharedMessage& message); // Queue for one of this shard's sessions
+    void joinRoomEpoll(Shard& shard, Connection* conn, std::string_view room); // Add to the shard's member list of a room
+    void leaveRoomEpoll(Shard& shard, Connection* conn, std::string_view room); // Remove from the shard's member list of a room
+    void postToShard(Shard& shard, InboundMessage* msg); // Push onto another shard's inbox and wake it if needed
+    void drainInbox(Shard& shard); // Fan-out every message other shards posted to this one
+    // ======================
+
+    // ===== Uring mode (shards reuse the Epoll mode fan-out) =====
+    bool startUringShard(Shard& shard); // Listener, eventfd and ring with its provided buffers, first requests queued
+    void uringLoop(Shard& shard); // Submit, wait and dispatch completions until stopped
+    void collectUring(Shard& shard, const io_uring_cqe& cqe); // Complete sends now, queue the rest in Shard::completions
+    void pumpSends(Shard& shard); // Submit pending output and reap what completed
+    void completeUring(Shard& shard, const io_uring_cqe& cqe); // Act on one completion
+    void submitSends(Shard& shard); // One SENDMSG per client with output, all submitted by the next enter
+    // ===========================================================
+
+    int port; // Port number
+    int listening; // Listening socket (Threaded mode)
+    ServerOptions options; // Server configuration
+
+    std::vector<std::unique_ptr<Shard>> shards; // Event loops (Epoll mode)
+
+    Archive archive; // Bounded MPSC ring + consumer thread behind addMessageToQueue()
+    ArchiveSink archive_sink; // Extra sink set by setArchiveSink(), runs after the log
+    std::unique_ptr<MessageLog> message_log; // Written by the archive consumer thread only
+    AdminEndpoint admin; // Serves metricsText() when options.adminPort is set
+
+    static constexpr uint64_t WRITER_WAKE_TAG = UINT64_MAX; // epoll tag of writer_wake_fd, clients use (slot << 32 | fd)
+    static constexpr uint64_t LISTEN_TAG = UINT64_MAX - 1; // epoll tag of the listener in dispatch_epoll_fd, clients use their pointer
+    static constexpr unsigned URING_ENTRIES = 4096; // Submission slots per shard ring
+    static constexpr unsigned URING_BUFFERS = 512; // Provided receive buffers per shard
+    static constexpr unsigned URING_BUFFER_SIZE = 4096; // Bytes per provided buffer
+    static constexpr unsigned URING_REAP_BATCH = 8; // Completions (or inbox messages) handled before their output is submitted
+    static constexpr size_t URING_READ_BACKLOG = 128 * 1024; // Received but unhandled bytes per client before its recv is cancelled
+    int dispatch_epoll_fd = -1; // Listener and idle client sockets, one-shot (Threaded mode)
+    int dispatch_wake_fd = -1; // Eventfd used by stop() to wake the dispatcher
+    std::thread dispatch_thread; // Thread running dispatchLoop()
+    WorkerPool workers; // Runs handleClient() tasks, never more threads than options.workers
+    TimingWheel dispatch_timers; // Throttled clients' resume times and idle timers (Threaded mode), fired by the dispatcher
+    std::mutex timers_mutex; // Guards dispatch_timers: workers schedule, the dispatcher fires
+    int writer_epoll_fd = -1; // EPOLLOUT notifications for every client (Threaded mode)
+    int writer_wake_fd = -1; // Eventfd used by stop() to wake the writer thread
+    std::thread writer_thread; // Thread running writerLoop()
+
+    HistoryRing history; // Recent messages replayed to new clients (Threaded mode)
+    std::mutex history_mutex; // Orders history pushes against the snapshot taken at accept
+
+    ClientRegistry registry; // Every live client, iterated lock-free by broadcasters
+    RoomTable rooms; // Room members (Threaded mode), Epoll shards keep their own
+    NameTable names; // Session ids and room ids handed out by the handshake
+    UserDirectory directory; // Nickname -> connections, for direct messages
+    RoomRateLimiter room_limits; // Per-room token buckets, shared by every mode
+    SharedMessage ping_frame; // Sent to every silent client, shared like a broadcast
+    uint64_t epoch_ms; // Server start, Message timestamps count from here
 };
@@ -0,0 +1,158 @@
+#include "slab_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <sys/mman.h>
+
+namespace
+{
+    constexpr size_t CLASSES = 11; // MIN_BLOCK << 0 .. MIN_BLOCK << 10 (64 B .. 64 KB)
+
+    struct FreeBlock // Overlays a block while it is free
+    {
+        FreeBlock* next; // Next block of the same list
+        FreeBlock* nextBatch; // Depot only: next batch, linked through its first block
+        size_t count; // Depot only: blocks in this batch
+    };
+
+    struct Depot // Batches of free blocks of one class, shared by every thread
+    {
+        std::mutex mutex; // Taken once per batch, never per block
+        FreeBlock* batches = nullptr; // Stack of batches
+    };
+
+    struct ThreadCache // Per-thread free lists, one per class
+    {
+        FreeBlock* lists[CLASSES] = {};
+        size_t counts[CLASSES] = {};
+        ~ThreadCache(); // Thread exit: everything goes back to the depots
+    };
+
+    Depot depots[CLASSES];
+    std::atomic<uint64_t> slab_count{0};
+    std::atomic<uint64_t> large_allocations{0};
+    thread_local ThreadCache cache;
+    thread_local bool cache_gone = false; // Frees during thread teardown bypass the destroyed cache
+
+    size_t classOf(size_t size)
+    {
+        if (size <= slab::MIN_BLOCK) return 0;
+        return (64 - __builtin_clzll(size - 1)) - 6; // ceil(log2(size)) - log2(MIN_BLOCK)
+    }
+
+    size_t blockSize(size_t cls) { return slab::MIN_BLOCK << cls; }
+    size_t batchSize(size_t cls) { return std::max<size_t>(2, 16 * 1024 / blockSize(cls)); } // Blocks moved per depot trip
+
+    void putBatch(size_t cls, FreeBlock* head, size_t count)
+    {
+        head->count = count;
+        std::lock_guard<std::mutex> lock(depots[cls].mutex);
+        head->nextBatch = depots[cls].batches;
+        depots[cls].batches = head;
+    }
+
+    FreeBlock* carve(size_t cls, size_t& count) // Map a new slab and link all of its blocks
+    {
+        void* mem = mmap(nullptr, slab::SLAB_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) throw std::bad_alloc();
+        slab_count.fetch_add(1, std::memory_order_relaxed);
+
+        size_t size = blockSize(cls);
+        char* base = static_cast<char*>(mem);
+        count = slab::SLAB_BYTES / size;
+        for (size_t i = 0; i < count; ++i)
+        {
+            FreeBlock* block = reinterpret_cast<FreeBlock*>(base + i * size);
+            block->next = i + 1 < count ? reinterpret_cast<FreeBlock*>(base + (i + 1) * size) : nullptr;
+        }
+        return reinterpret_cast<FreeBlock*>(base);
+    }
+
+    FreeBlock* takeBatch(size_t cls, size_t& count) // A batch from the depot, or a fresh slab if it has none
+    {
+        {
+            std::lock_guard<std::mutex> lock(depots[cls].mutex);
+            FreeBlock* head = depots[cls].batches;
+            if (head != nullptr)
+            {
+                depots[cls].batches = head->nextBatch;
+                count = head->count;
+                return head;
+            }
+        }
+        return carve(cls, count);
+    }
+
+    ThreadCache::~ThreadCache()
+    {
+        for (size_t cls = 0; cls < CLASSES; ++cls)
+        {
+            if (lists[cls] != nullptr) putBatch(cls, lists[cls], counts[cls]);
+        }
+        cache_gone = true;
+    }
+}
+
+void* slab::allocate(size_t size)
+{
+    if (size > MAX_BLOCK)
+    {
+        large_allocations.fetch_add(1, std::memory_order_relaxed);
+        return ::operator new(size);
+    }
+
+    size_t cls = classOf(size);
+    if (cache_gone) // Thread teardown: one block straight from the depot
+    {
+        size_t count;
+        FreeBlock* head = takeBatch(cls, count);
+        if (count > 1) putBatch(cls, head->next, count - 1);
+        return head;
+    }
+
+    ThreadCache& local = cache;
+    if (local.lists[cls] == nullptr) local.lists[cls] = takeBatch(cls, local.counts[cls]);
+    FreeBlock* block = local.lists[cls];
+    local.lists[cls] = block->next;
+    --local.counts[cls];
+    return block;
+}
+
+void slab::release(void* block, size_t size)
+{
+    if (block == nullptr) return;
+    if (size > MAX_BLOCK)
+    {
+        ::operator delete(block);
+        return;
+    }
+
+    size_t cls = classOf(size);
+    FreeBlock* freed = static_cast<FreeBlock*>(block);
+    if (cache_gone)
+    {
+        freed->next = nullptr;
+        putBatch(cls, freed, 1);
+        return;
+    }
+
+    ThreadCache& local = cache;
+    freed->next = local.lists[cls];
+    local.lists[cls] = freed;
+    size_t batch = batchSize(cls);
+    if (++local.counts[cls] < 2 * batch) return;
+
+    FreeBlock* tail = freed; // Keep one batch, hand the most recently freed one to the depot
+    for (size_t i = 1; i < batch; ++i) tail = tail->next;
+    local.lists[cls] = tail->next;
+    tail->next = nullptr;
+    local.counts[cls] -= batch;
+    putBatch(cls, freed, batch);
+}
+
+SlabStats slab::stats()
+{
+    uint64_t slabs = slab_count.load(std::memory_order_relaxed);
+    return SlabStats{slabs, size_t(slabs) * SLAB_BYTES, large_allocations.load(std::memory_order_relaxed)};
+}
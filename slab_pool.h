@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Size-classed slab pool for the buffers the message path allocates over and over: message
+// blocks, receive buffers, outbound and task queue nodes, shard inbox entries. Blocks come in
+// power-of-two classes from MIN_BLOCK to MAX_BLOCK, carved out of SLAB_BYTES slabs that are
+// mapped once and never returned. Every thread keeps a free list per class, so allocate()
+// and release() are a pointer pop/push without a lock; a thread that frees more than it
+// allocates (the last reader of a message is often not its creator) hands whole batches to
+// a shared depot, where the allocating threads pick them up again. Requests above MAX_BLOCK
+// go to operator new.
+
+struct SlabStats
+{
+    uint64_t slabs; // Slabs mapped so far
+    size_t reservedBytes; // Memory held by those slabs
+    uint64_t largeAllocations; // Requests above MAX_BLOCK handed to operator new
+};
+
+namespace slab
+{
+    constexpr size_t MIN_BLOCK = 64; // Smallest class, holds the free-list links
+    constexpr size_t MAX_BLOCK = 64 * 1024; // Largest class
+    constexpr size_t SLAB_BYTES = 256 * 1024; // Mapped at once, split into blocks of one class
+
+    void* allocate(size_t size); // Block of at least size bytes, 16-byte aligned
+    void release(void* block, size_t size); // size as passed to allocate(); any thread may free
+    SlabStats stats();
+}
+
+template <typename T>
+struct SlabAllocator // Standard allocator over the slab pool, for node-based containers on the hot path
+{
+    using value_type = T;
+
+    SlabAllocator() = default;
+    template <typename U> SlabAllocator(const SlabAllocator<U>&) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(slab::allocate(n * sizeof(T))); }
+    void deallocate(T* p, size_t n) { slab::release(p, n * sizeof(T)); }
+
+    template <typename U> bool operator==(const SlabAllocator<U>&) const { return true; } // One shared pool
+    template <typename U> bool operator!=(const SlabAllocator<U>&) const { return false; }
+};
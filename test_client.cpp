@@ -1,10 +1,14 @@
 #include "client.h"
+#include "client_pool.h"
 #include "server.h"
 #include <iostream>
 #include <thread>
 #include <chrono>
 #include <string>
 #include <unistd.h>
+#include <atomic>
+#include <sys/socket.h>
+#include <arpa/inet.h>
 
 int main() 
 {
@@ -15,6 +19,19 @@ int main()
 
     // Start server
     Server server(port);
+    std::atomic<int> archivedFromEve{0};
+    std::atomic<int> archivedFromHeidi{0};
+    server.setArchiveSink([&archivedFromEve, &archivedFromHeidi](const SharedMessage* batch, size_t count) 
+    {
+        for (size_t i = 0; i < count; ++i) 
+        {
+            MessageHeader header;
+            std::string_view text = batch[i].payload(); // Named clients send compact Message frames
+            if (static_cast<FrameType>(batch[i].wire()[4]) == FrameType::Message && !parseMessagePayload(batch[i].payload(), header, text)) continue;
+            if (text == "Hello from Eve") archivedFromEve++;
+            if (text.substr(0, 6) == "burst ") archivedFromHeidi++;
+        }
+    });
     
     std::thread serverThread([&server]() { server.start(); });
     std::this_thread::sleep_for(std::chrono::seconds(1));
@@ -199,18 +216,359 @@ int main()
     }
     std::cout << "=======================================\n" << std::endl;
 
-    // 5) Print server's message queue (explicit test)
+    // 5) Check the server's message archive (explicit test)
     std::cout << "========================================" << std::endl;
-    std::cout << "5) Testing message queue display" << std::endl;
+    std::cout << "5) Testing message archive" << std::endl;
     {
-        std::cout << "Print all messsages sent" << std::endl;
-        server.printMessageQueue();
+        ArchiveStats stats = server.archiveStats();
+        std::cout << "Archive: " << stats.enqueued << " enqueued, " << stats.archived << " archived, "
+                  << stats.dropped << " dropped, " << stats.pending << " pending" << std::endl;
+
+        if (archivedFromEve == 1) 
+        {
+            std::cout << "✓ Eve's message reached the archive sink" << std::endl;
+        } 
+        else 
+        {
+            std::cout << "✗ Archive sink saw Eve's message " << archivedFromEve << " time(s)" << std::endl;
+        }
     }
     std::cout << "========================================\n" << std::endl;
 
-    // 6) Disconnect after server shutdown
+    // 6) Async send mode coalesces a burst into writev batches
+    std::cout << "=============================================" << std::endl;
+    std::cout << "6) Testing async send coalescing" << std::endl;
+    {
+        ClientOptions options;
+        options.asyncSend = true;
+        options.noDelay = true;
+        options.flushDeadline = std::chrono::microseconds(200);
+        Client c1(host, port, "Heidi", options);
+
+        const int burst = 500;
+        int accepted = 0;
+        if (c1.connectToServer()) 
+        {
+            std::cout << "✓ Heidi connected in async mode" << std::endl;
+            for (int i = 0; i < burst; ++i) 
+            {
+                if (c1.sendMessage("burst " + std::to_string(i))) ++accepted;
+            }
+        } 
+        else 
+        {
+            std::cout << "✗ Heidi failed to connect" << std::endl;
+        }
+
+        c1.disconnect(); // Drains the queue before closing
+        ClientSendStats stats = c1.sendStats();
+        std::cout << "Send queue: " << stats.sent << " sent in " << stats.batches << " batch(es), largest "
+                  << stats.largestBatch << ", " << stats.dropped << " dropped, " << stats.queued << " queued" << std::endl;
+
+        if (accepted == burst && stats.sent == static_cast<uint64_t>(burst) && stats.queued == 0) 
+        {
+            std::cout << "✓ All " << burst << " queued messages were written" << std::endl;
+        } 
+        else 
+        {
+            std::cout << "✗ Accepted " << accepted << ", wrote " << stats.sent << " of " << burst << std::endl;
+        }
+
+        if (stats.batches > 0 && stats.batches < stats.sent) 
+        {
+            std::cout << "✓ Burst coalesced (" << static_cast<double>(stats.sent) / stats.batches << " messages per writev)" << std::endl;
+        } 
+        else 
+        {
+            std::cout << "✗ Messages were not batched" << std::endl;
+        }
+
+        for (int waited = 0; waited < 2000 && archivedFromHeidi < burst; waited += 50) 
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        if (archivedFromHeidi == burst) 
+        {
+            std::cout << "✓ Server received every message intact and in frames" << std::endl;
+        } 
+        else 
+        {
+            std::cout << "✗ Server received " << archivedFromHeidi << " of " << burst << " messages" << std::endl;
+        }
+    }
+    std::cout << "=============================================\n" << std::endl;
+
+    // 7) Callback receive API
+    std::cout << "==========================================" << std::endl;
+    std::cout << "7) Testing message callback" << std::endl;
+    {
+        std::atomic<int> received{0};
+        std::atomic<int> outOfOrder{0};
+        std::atomic<int> roomMessages{0};
+        Client receiver(host, port, "Judy");
+        receiver.setMessageHandler([&](const ClientMessage& message)
+        {
+            if (message.sender != "Ivan") return; // History replayed on join
+            if (!message.room.empty())
+            {
+                if (message.room == "lab" && message.text == "in the lab") roomMessages++;
+                return;
+            }
+            int n = received.load();
+            if (message.text != std::to_string(n) || message.sequence != static_cast<uint64_t>(n) + 1) outOfOrder++;
+            received++;
+        });
+
+        ClientOptions options;
+        options.asyncSend = true;
+        Client sender(host, port, "Ivan", options);
+
+        bool okR = receiver.connectToServer();
+        bool okS = sender.connectToServer();
+        if (okR && okS) std::cout << "✓ Judy and Ivan connected" << std::endl; else std::cout << "✗ Judy or Ivan failed to connect" << std::endl;
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+        const int burst = 2000;
+        for (int i = 0; i < burst; ++i) 
+        {
+            while (!sender.sendMessage(std::to_string(i))) std::this_thread::sleep_for(std::chrono::milliseconds(1)); // Queue full
+        }
+        receiver.joinRoom("lab");
+        sender.joinRoom("lab"); // Members learn the room's id and send compact room messages
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        sender.sendToRoom("lab", "in the lab");
+
+        for (int waited = 0; waited < 3000 && (received < burst || roomMessages < 1); waited += 50) 
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+
+        if (received == burst && outOfOrder == 0) 
+        {
+            std::cout << "✓ Callback got all " << burst << " messages in order" << std::endl;
+        } 
+        else 
+        {
+            std::cout << "✗ Callback got " << received << " of " << burst << " messages, " << outOfOrder << " out of order" << std::endl;
+        }
+
+        if (roomMessages == 1) 
+        {
+            std::cout << "✓ Callback got the room message with its room name" << std::endl;
+        } 
+        else 
+        {
+            std::cout << "✗ Callback got " << roomMessages << " room message(s)" << std::endl;
+        }
+
+        sender.disconnect();
+        receiver.disconnect();
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    }
+    std::cout << "==========================================\n" << std::endl;
+
+    // 8) Handshake: the name travels once, messages carry ids
+    std::cout << "================================================" << std::endl;
+    std::cout << "8) Testing session handshake" << std::endl;
+    {
+        std::string lastSender, lastText;
+        uint64_t lastTimestamp = 0;
+        std::atomic<int> got{0};
+        Client receiver(host, port, "Ken");
+        receiver.setMessageHandler([&](const ClientMessage& message)
+        {
+            if (message.type != FrameType::Message || message.text != "compact") return;
+            lastSender = std::string(message.sender);
+            lastText = std::string(message.text);
+            lastTimestamp = message.timestampMs;
+            got++;
+        });
+        Client sender(host, port, "Laura");
+        Client anonymous(host, port);
+
+        bool ok = receiver.connectToServer() && sender.connectToServer() && anonymous.connectToServer();
+        if (ok && receiver.sessionId() != 0 && sender.sessionId() != 0 && sender.sessionId() != receiver.sessionId() && anonymous.sessionId() == 0) 
+        {
+            std::cout << "✓ Named clients got session ids " << receiver.sessionId() << " and " << sender.sessionId() << ", anonymous none" << std::endl;
+        } 
+        else 
+        {
+            std::cout << "✗ Handshake failed" << std::endl;
+        }
+
+        auto before = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        sender.sendMessage("compact");
+        for (int waited = 0; waited < 2000 && got < 1; waited += 20) 
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+
+        if (got == 1 && lastSender == "Laura" && static_cast<int64_t>(lastTimestamp) >= before - 1000 && static_cast<int64_t>(lastTimestamp) <= before + 1000) 
+        {
+            std::cout << "✓ Receiver resolved the sender id to 'Laura' with a sane timestamp" << std::endl;
+        } 
+        else 
+        {
+            std::cout << "✗ Receiver got " << got << " message(s), sender '" << lastSender << "'" << std::endl;
+        }
+
+        std::atomic<bool> directSeen{false};
+        receiver.disconnect(); // Reconnect with a handler that checks for the direct message
+        receiver.setMessageHandler([&directSeen](const ClientMessage& message)
+        {
+            if (message.type == FrameType::Direct && message.sender == "Laura" && message.text == "just for Ken") directSeen = true;
+        });
+        receiver.connectToServer();
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+        if (sender.sendDirect("Ken", "just for Ken") && !anonymous.sendDirect("Ken", "who am I")) 
+        {
+            std::cout << "✓ Named client sent a direct message, anonymous one refused" << std::endl;
+        } 
+        else 
+        {
+            std::cout << "✗ sendDirect results unexpected" << std::endl;
+        }
+        for (int waited = 0; waited < 2000 && !directSeen; waited += 20) 
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        if (directSeen) 
+        {
+            std::cout << "✓ Ken received Laura's direct message" << std::endl;
+        } 
+        else 
+        {
+            std::cout << "✗ Direct message did not arrive" << std::endl;
+        }
+
+        sender.disconnect();
+        receiver.disconnect();
+        anonymous.disconnect();
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    }
+    std::cout << "================================================\n" << std::endl;
+
+    // 9) Many sessions sharing a few event-loop threads
+    std::cout << "=========================================" << std::endl;
+    std::cout << "9) Testing client pool" << std::endl;
+    {
+        const int sessions = 200;
+        std::atomic<int> greetings{0};
+        std::atomic<int> connects{0};
+        std::atomic<int> disconnects{0};
+
+        PoolOptions options;
+        options.threads = 2;
+        options.reconnectDelay = std::chrono::milliseconds(50);
+        ClientPool pool(options);
+        pool.setMessageHandler([&greetings](SessionId, const ClientMessage& message)
+        {
+            if (message.sender == "pool-0" && message.text == "hello") greetings++;
+        });
+        pool.setStateHandler([&connects, &disconnects](SessionId, bool connected)
+        {
+            if (connected) connects++; else disconnects++;
+        });
+        pool.start();
+
+        std::vector<SessionId> ids;
+        for (int i = 0; i < sessions; ++i) ids.push_back(pool.open(host, port, "pool-" + std::to_string(i)));
+
+        for (int waited = 0; waited < 3000 && pool.stats().connected < sessions; waited += 50) 
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+        int connCount = server.get_connection_count();
+        if (pool.stats().connected == sessions && connCount == sessions) 
+        {
+            std::cout << "✓ " << sessions << " sessions connected on " << options.threads << " threads" << std::endl;
+        } 
+        else 
+        {
+            std::cout << "✗ Pool connected " << pool.stats().connected << " sessions, server sees " << connCount << std::endl;
+        }
+
+        pool.sendMessage(ids[0], "hello");
+        for (int waited = 0; waited < 2000 && greetings < sessions - 1; waited += 50) 
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        if (greetings == sessions - 1) 
+        {
+            std::cout << "✓ Broadcast reached the other " << greetings << " sessions" << std::endl;
+        } 
+        else 
+        {
+            std::cout << "✗ Broadcast reached " << greetings << " of " << sessions - 1 << " sessions" << std::endl;
+        }
+
+        pool.close(ids[0]);
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        if (!pool.isConnected(ids[0]) && pool.stats().sessions == sessions - 1 && server.get_connection_count() == sessions - 1) 
+        {
+            std::cout << "✓ Closed session left without affecting the others" << std::endl;
+        } 
+        else 
+        {
+            std::cout << "✗ Close: pool has " << pool.stats().sessions << " sessions, server sees " << server.get_connection_count() << std::endl;
+        }
+
+        // Reconnection: a session opened before its server exists connects once the server is up
+        const int latePort = 9980;
+        SessionId late = pool.open(host, latePort, "late");
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        bool waitedOffline = !pool.isConnected(late);
+
+        Server lateServer(latePort);
+        std::thread lateThread([&lateServer]() { lateServer.start(); });
+        for (int waited = 0; waited < 5000 && !pool.isConnected(late); waited += 50) 
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+
+        if (waitedOffline && pool.isConnected(late) && pool.stats().reconnects > 0) 
+        {
+            std::cout << "✓ Session kept retrying and connected after " << pool.stats().reconnects << " attempt(s)" << std::endl;
+        } 
+        else 
+        {
+            std::cout << "✗ Late session did not reconnect" << std::endl;
+        }
+
+        lateServer.stop();
+        if (lateThread.joinable()) lateThread.join();
+        for (int waited = 0; waited < 2000 && pool.isConnected(late); waited += 50) 
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        if (!pool.isConnected(late) && disconnects >= 2) 
+        {
+            std::cout << "✓ Session noticed its server going away" << std::endl;
+        } 
+        else 
+        {
+            std::cout << "✗ Session still connected after its server stopped" << std::endl;
+        }
+
+        pool.stop();
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        if (server.get_connection_count() == 0) 
+        {
+            std::cout << "✓ Pool stopped and closed every session" << std::endl;
+        } 
+        else 
+        {
+            std::cout << "✗ Server still sees " << server.get_connection_count() << " connection(s) after stop" << std::endl;
+        }
+    }
+    std::cout << "=========================================\n" << std::endl;
+
+    // 10) Disconnect after server shutdown
     std::cout << "====================================================" << std::endl;
-    std::cout << "6) Testing server shutdown and disconnection" << std::endl;
+    std::cout << "10) Testing server shutdown and disconnection" << std::endl;
     {
         Client c1(host, port, "Grace");
 
@@ -265,6 +623,83 @@ int main()
         c1.disconnect();
     }
     std::cout << "====================================================\n" << std::endl;
+
+    // 11) Heartbeats: pings keep a quiet connection alive, a dead server is detected
+    std::cout << "====================================================" << std::endl;
+    std::cout << "11) Testing client heartbeats" << std::endl;
+    {
+        ClientOptions options;
+        options.heartbeat = std::chrono::milliseconds(100);
+        options.idleTimeout = std::chrono::milliseconds(300);
+
+        ServerOptions pinging; // The server pings a quiet client, which answers on its own
+        pinging.heartbeatMs = 100;
+        pinging.idleTimeoutMs = 300;
+        Server quietServer(9961, pinging);
+        quietServer.start();
+        Client mike(host, 9961, "Mike"); // No heartbeat options of its own
+        Client nina(host, 9961, "Nina", options);
+        mike.connectToServer();
+        nina.connectToServer();
+        ClientPool pool; // Pool sessions that only listen answer pings from their loop
+        pool.start();
+        pool.open(host, 9961, "Paul");
+        pool.open(host, 9961);
+        std::this_thread::sleep_for(std::chrono::seconds(1)); // Nobody says anything
+
+        if (mike.isConnected() && nina.isConnected() && quietServer.get_connection_count() == 4)
+            std::cout << "✓ Quiet clients answered pings and stayed connected" << std::endl;
+        else
+            std::cout << "✗ Quiet clients connected: " << mike.isConnected() << "/" << nina.isConnected()
+                      << ", server sees " << quietServer.get_connection_count() << std::endl;
+        PoolStats stats = pool.stats();
+        if (stats.connected == 2 && stats.reconnects == 0)
+            std::cout << "✓ Quiet pool sessions answered pings, no reconnect" << std::endl;
+        else
+            std::cout << "✗ Pool sessions connected: " << stats.connected << ", " << stats.reconnects << " reconnect(s)" << std::endl;
+        pool.stop();
+        mike.disconnect();
+        nina.disconnect();
+        quietServer.stop();
+
+        int listener = socket(AF_INET, SOCK_STREAM, 0); // Accepts but never answers, like a hung server
+        int one = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(9960);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(listener, (sockaddr*)&addr, sizeof(addr));
+        listen(listener, 4);
+
+        Client oscar("127.0.0.1", 9960, "", options); // Without a name: no handshake to wait for
+        oscar.setMessageHandler([](const ClientMessage&) {}); // Quiet: the expected timeout isn't logged
+        bool connected = oscar.connectToServer();
+        int peer = accept(listener, nullptr, nullptr);
+        auto begin = std::chrono::steady_clock::now();
+        while (oscar.isConnected() && std::chrono::steady_clock::now() - begin < std::chrono::seconds(3))
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        FrameDecoder decoder;
+        int pings = 0;
+        ssize_t n;
+        while ((n = recv(peer, decoder.writePtr(), decoder.writable(), MSG_DONTWAIT)) > 0)
+        {
+            decoder.commit(static_cast<size_t>(n));
+            FrameView frame;
+            while (decoder.next(frame) == FrameDecoder::Status::Frame) pings += frame.type == FrameType::Ping;
+        }
+
+        if (connected && !oscar.isConnected() && seconds < 1.0 && pings >= 1)
+            std::cout << "✓ Client sent " << pings << " Ping(s) and gave up on a silent server after " << seconds << "s" << std::endl;
+        else
+            std::cout << "✗ Client connected: " << connected << ", still connected after " << seconds << "s, " << pings << " Ping(s)" << std::endl;
+        oscar.disconnect();
+        close(peer);
+        close(listener);
+    }
+    std::cout << "====================================================\n" << std::endl;
     
     std::cout << "✓✓✓ All tests finished" << std::endl;
     return 0;
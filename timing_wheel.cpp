@@ -0,0 +1,90 @@
+#include "timing_wheel.h"
+#include <climits>
+
+TimingWheel::TimingWheel(uint64_t nowMs) : current_(nowMs) // Constructor
+{
+    for (auto& level : slots_)
+    {
+        for (TimerNode& slot : level) slot.next = slot.prev = &slot;
+    }
+}
+
+void TimingWheel::schedule(TimerNode& node, uint64_t deadlineMs)
+{
+    if (node.scheduled()) unlink(node);
+    node.deadline = deadlineMs > current_ ? deadlineMs : current_ + 1; // The current tick's slot was already fired
+    insert(node);
+}
+
+void TimingWheel::cancel(TimerNode& node)
+{
+    if (node.scheduled()) unlink(node);
+}
+
+int TimingWheel::timeoutMs(uint64_t nowMs) const
+{
+    if (size_ == 0) return -1;
+
+    uint64_t next = UINT64_MAX; // Earliest tick that fires a timer or moves one closer
+    for (unsigned level = 0; level < LEVELS; ++level)
+    {
+        unsigned shift = level * SLOT_BITS;
+        for (uint64_t i = 1; i <= SLOTS; ++i)
+        {
+            uint64_t index = (current_ >> shift) + i;
+            const TimerNode& slot = slots_[level][index & (SLOTS - 1)];
+            if (slot.next != &slot)
+            {
+                if ((index << shift) < next) next = index << shift;
+                break;
+            }
+        }
+    }
+
+    if (next <= nowMs) return 0;
+    return next - nowMs > uint64_t(INT_MAX) ? INT_MAX : int(next - nowMs);
+}
+
+void TimingWheel::insert(TimerNode& node)
+{
+    uint64_t delta = node.deadline - current_;
+    unsigned level = 0;
+    while (level < LEVELS && delta >= (uint64_t(1) << ((level + 1) * SLOT_BITS))) ++level;
+    if (level == LEVELS) // Beyond the top level's range
+    {
+        level = LEVELS - 1;
+        node.deadline = current_ + (uint64_t(1) << (LEVELS * SLOT_BITS)) - 1;
+    }
+
+    TimerNode& slot = slots_[level][(node.deadline >> (level * SLOT_BITS)) & (SLOTS - 1)];
+    node.prev = slot.prev;
+    node.next = &slot;
+    slot.prev->next = &node;
+    slot.prev = &node;
+    ++size_;
+}
+
+void TimingWheel::unlink(TimerNode& node)
+{
+    node.prev->next = node.next;
+    node.next->prev = node.prev;
+    node.next = node.prev = nullptr;
+    --size_;
+}
+
+void TimingWheel::cascade()
+{
+    unsigned top = 0; // Highest level whose slot comes due at this tick
+    while (top + 1 < LEVELS && (current_ & ((uint64_t(1) << ((top + 1) * SLOT_BITS)) - 1)) == 0) ++top;
+
+    for (unsigned level = top; level >= 1; --level) // Top down: a timer may drop several levels at once
+    {
+        TimerNode& slot = slots_[level][(current_ >> (level * SLOT_BITS)) & (SLOTS - 1)];
+        while (slot.next != &slot)
+        {
+            TimerNode* node = slot.next;
+            unlink(*node);
+            insert(*node);
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Hierarchical timing wheel: LEVELS wheels of SLOTS slots, one tick per millisecond at the
+// bottom and SLOTS times coarser on every level above. A timer goes into the lowest level
+// whose range covers its deadline and moves down one level each time the wheel below wraps,
+// so scheduling, cancelling and firing are O(1) no matter how many timers are pending.
+// Timers are intrusive TimerNodes embedded in their owner; the wheel never allocates.
+// Deadlines further out than the top level's range are clamped to it. Not thread-safe: one
+// thread owns a wheel, or callers serialize access.
+
+struct TimerNode
+{
+    void* owner = nullptr; // Whatever the timer belongs to, for the expiry callback
+    TimerNode* next = nullptr; // Slot list, nullptr while not scheduled
+    TimerNode* prev = nullptr;
+    uint64_t deadline = 0; // Tick (ms) the timer fires at
+
+    bool scheduled() const { return next != nullptr; }
+};
+
+class TimingWheel {
+public:
+    static constexpr unsigned LEVELS = 4;
+    static constexpr unsigned SLOT_BITS = 6;
+    static constexpr unsigned SLOTS = 1u << SLOT_BITS; // Range: SLOTS^LEVELS ms, about 4.6 hours
+
+    explicit TimingWheel(uint64_t nowMs = 0); // Constructor, the wheel starts at nowMs
+    TimingWheel(const TimingWheel&) = delete;
+    TimingWheel& operator=(const TimingWheel&) = delete;
+
+    void schedule(TimerNode& node, uint64_t deadlineMs); // (Re)arm: fires on the first advance() at or past deadlineMs
+    void cancel(TimerNode& node); // No-op if not scheduled
+    int timeoutMs(uint64_t nowMs) const; // Until the next timer may fire (for epoll_wait), -1 if none is pending
+    size_t size() const { return size_; }
+
+    template <typename Fn> size_t advance(uint64_t nowMs, Fn&& fn) // fn(TimerNode&) for every timer due by nowMs
+    {
+        size_t fired = 0;
+        if (size_ == 0)
+        {
+            if (nowMs > current_) current_ = nowMs;
+            return 0;
+        }
+        while (current_ < nowMs && size_ > 0)
+        {
+            ++current_;
+            cascade();
+            TimerNode& slot = slots_[0][current_ & (SLOTS - 1)];
+            while (slot.next != &slot) // fn may schedule new timers, they never land in this slot
+            {
+                TimerNode* node = slot.next;
+                unlink(*node);
+                fn(*node);
+                ++fired;
+            }
+        }
+        if (current_ < nowMs) current_ = nowMs;
+        return fired;
+    }
+
+private:
+    void insert(TimerNode& node); // Into the slot matching node.deadline
+    void unlink(TimerNode& node);
+    void cascade(); // Move the slots that come due at current_ one level down
+
+    TimerNode slots_[LEVELS][SLOTS]; // Sentinels of circular lists
+    uint64_t current_; // Last tick processed
+    size_t size_ = 0; // Scheduled timers
+};
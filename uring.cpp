@@ -0,0 +1,243 @@
+#include "uring.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+    int uringSetup(unsigned entries, io_uring_params* params)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    int uringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags, const void* arg = nullptr, size_t argSize = 0)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argSize));
+    }
+
+    int uringRegister(int fd, unsigned opcode, void* arg, unsigned count)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+    }
+}
+
+Uring::~Uring()
+{
+    if (fd_ != -1) close(fd_); // Before the buffers go: the kernel cancels with the instance
+    if (buf_ring_ != nullptr) munmap(buf_ring_, buf_ring_size_);
+    std::free(buffers_);
+    if (sqes_ != nullptr) munmap(sqes_, sqes_size_);
+    if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) munmap(cq_ring_, cq_ring_size_);
+    if (sq_ring_ != nullptr) munmap(sq_ring_, sq_ring_size_);
+}
+
+bool Uring::supported()
+{
+    Uring ring;
+    if (!ring.init(8) || !ring.setupBuffers(0, 2, 64)) return false; // Buffer rings: 5.19
+
+    std::vector<char> storage(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), 0);
+    io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+    if (uringRegister(ring.fd_, IORING_REGISTER_PROBE, probe, 256) == -1) return false;
+    for (int op : {IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SENDMSG, IORING_OP_POLL_ADD, IORING_OP_ASYNC_CANCEL})
+    {
+        if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED))
+        {
+            errno = EOPNOTSUPP;
+            return false;
+        }
+    }
+
+    int pair[2]; // Multishot recv (6.0) can't be probed by opcode, try one on a socket pair
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) == -1) return false;
+    bool received = false;
+    if (write(pair[1], "x", 1) == 1 && ring.recvMultishot(pair[0], 0, 1) && ring.submit(1) >= 0)
+    {
+        ring.reap([&received](const io_uring_cqe& cqe) { received = cqe.res == 1 && (cqe.flags & IORING_CQE_F_BUFFER); });
+    }
+    close(pair[0]);
+    close(pair[1]);
+    if (!received) errno = EOPNOTSUPP;
+    return received;
+}
+
+bool Uring::init(unsigned entries)
+{
+    io_uring_params params{};
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN; // Completions are reaped on our own enter calls anyway
+    params.cq_entries = entries * 4; // Multishot requests complete many times per submission
+    fd_ = uringSetup(entries, &params);
+    if (fd_ == -1 && errno == EINVAL) // COOP_TASKRUN needs 5.19
+    {
+        params = io_uring_params{};
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = entries * 4;
+        fd_ = uringSetup(entries, &params);
+    }
+    if (fd_ == -1) return false;
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single) sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) { sq_ring_ = nullptr; return false; }
+    cq_ring_ = single ? sq_ring_ : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+    if (cq_ring_ == MAP_FAILED) { cq_ring_ = nullptr; return false; }
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) return false;
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    char* sq = static_cast<char*>(sq_ring_);
+    sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_entries_ = params.sq_entries;
+    sqe_tail_ = sqe_submitted_ = *sq_tail_;
+
+    char* cq = static_cast<char*>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+}
+
+bool Uring::setupBuffers(uint16_t group, unsigned count, unsigned size)
+{
+    buf_ring_size_ = count * sizeof(io_uring_buf);
+    void* ring = mmap(nullptr, buf_ring_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0); // Page aligned
+    if (ring == MAP_FAILED) return false;
+    buf_ring_ = static_cast<io_uring_buf_ring*>(ring);
+
+    io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring_);
+    reg.ring_entries = count;
+    reg.bgid = group;
+    if (uringRegister(fd_, IORING_REGISTER_PBUF_RING, &reg, 1) == -1) return false;
+
+    buffers_ = static_cast<char*>(std::malloc(size_t(count) * size));
+    if (buffers_ == nullptr) return false;
+    buffer_count_ = count;
+    buffer_size_ = size;
+    for (unsigned i = 0; i < count; ++i) recycle(static_cast<uint16_t>(i));
+    return true;
+}
+
+void Uring::recycle(uint16_t id)
+{
+    io_uring_buf* entries = reinterpret_cast<io_uring_buf*>(buf_ring_); // Not buf_ring_->bufs: C++ pads the flex array wrapper
+    io_uring_buf& entry = entries[buf_tail_ & (buffer_count_ - 1)];
+    entry.addr = reinterpret_cast<uint64_t>(buffer(id));
+    entry.len = buffer_size_;
+    entry.bid = id;
+    ++buf_tail_;
+    __atomic_store_n(&buf_ring_->tail, buf_tail_, __ATOMIC_RELEASE); // Entry visible before the kernel sees the new tail
+}
+
+io_uring_sqe* Uring::sqe()
+{
+    if (sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_)
+    {
+        submit();
+        if (sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_) return nullptr;
+    }
+
+    unsigned index = sqe_tail_ & sq_mask_;
+    io_uring_sqe* entry = &sqes_[index];
+    std::memset(entry, 0, sizeof(*entry));
+    sq_array_[index] = index;
+    ++sqe_tail_;
+    return entry;
+}
+
+int Uring::submit(unsigned waitFor, int timeoutMs)
+{
+    __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+    unsigned flags = waitFor > 0 ? IORING_ENTER_GETEVENTS : 0;
+    int n;
+    if (waitFor > 0 && timeoutMs >= 0) // Bounded wait (5.11), -ETIME once it runs out
+    {
+        __kernel_timespec timeout{timeoutMs / 1000, (timeoutMs % 1000) * 1000000LL};
+        io_uring_getevents_arg arg{};
+        arg.ts = reinterpret_cast<uint64_t>(&timeout);
+        n = uringEnter(fd_, pending(), waitFor, flags | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    }
+    else
+    {
+        n = uringEnter(fd_, pending(), waitFor, flags);
+    }
+    if (n < 0) return -errno;
+    sqe_submitted_ += static_cast<unsigned>(n);
+    return n;
+}
+
+bool Uring::acceptMultishot(int fd, uint64_t tag, int flags)
+{
+    io_uring_sqe* entry = sqe();
+    if (entry == nullptr) return false;
+    entry->opcode = IORING_OP_ACCEPT;
+    entry->fd = fd;
+    entry->ioprio = IORING_ACCEPT_MULTISHOT;
+    entry->accept_flags = static_cast<uint32_t>(flags);
+    entry->user_data = tag;
+    return true;
+}
+
+bool Uring::recvMultishot(int fd, uint16_t group, uint64_t tag)
+{
+    io_uring_sqe* entry = sqe();
+    if (entry == nullptr) return false;
+    entry->opcode = IORING_OP_RECV;
+    entry->fd = fd;
+    entry->ioprio = IORING_RECV_MULTISHOT;
+    entry->flags = IOSQE_BUFFER_SELECT; // The kernel picks a buffer from the group per completion
+    entry->buf_group = group;
+    entry->user_data = tag;
+    return true;
+}
+
+bool Uring::pollMultishot(int fd, uint64_t tag)
+{
+    io_uring_sqe* entry = sqe();
+    if (entry == nullptr) return false;
+    entry->opcode = IORING_OP_POLL_ADD;
+    entry->fd = fd;
+    entry->len = IORING_POLL_ADD_MULTI;
+    entry->poll32_events = POLLIN;
+    entry->user_data = tag;
+    return true;
+}
+
+bool Uring::cancel(uint64_t target, uint64_t tag)
+{
+    io_uring_sqe* entry = sqe();
+    if (entry == nullptr) return false;
+    entry->opcode = IORING_OP_ASYNC_CANCEL;
+    entry->fd = -1;
+    entry->addr = target;
+    entry->user_data = tag;
+    return true;
+}
+
+bool Uring::sendmsg(int fd, const msghdr* msg, uint64_t tag)
+{
+    io_uring_sqe* entry = sqe();
+    if (entry == nullptr) return false;
+    entry->opcode = IORING_OP_SENDMSG;
+    entry->fd = fd;
+    entry->addr = reinterpret_cast<uint64_t>(msg);
+    entry->len = 1;
+    entry->msg_flags = MSG_NOSIGNAL;
+    entry->user_data = tag;
+    return true;
+}
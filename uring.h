@@ -0,0 +1,78 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+#include <sys/socket.h>
+
+// Minimal io_uring wrapper on the raw syscalls (no liburing dependency). One instance is a
+// submission ring, a completion ring and optionally one provided-buffer ring, all mapped
+// into this process. It is not thread-safe: every shard owns its own instance and is the
+// only thread preparing, submitting and reaping on it.
+
+class Uring {
+public:
+    Uring() = default;
+    ~Uring(); // Unmaps the rings and closes the instance, which cancels what is still in flight
+    Uring(const Uring&) = delete;
+    Uring& operator=(const Uring&) = delete;
+
+    static bool supported(); // Kernel offers multishot accept/recv, buffer rings and SENDMSG (errno set if not)
+
+    bool init(unsigned entries); // Submission ring of entries slots, completion ring four times that. False with errno set
+    bool setupBuffers(uint16_t group, unsigned count, unsigned size); // Register count buffers of size bytes (count a power of two)
+
+    io_uring_sqe* sqe(); // Next free submission entry, zeroed. Submits first if the ring is full, nullptr if it stays full
+    int submit(unsigned waitFor = 0, int timeoutMs = -1); // Hand every prepared entry to the kernel, optionally waiting (up to timeoutMs) for completions. -errno on failure
+    unsigned pending() const { return sqe_tail_ - sqe_submitted_; } // Prepared, not yet submitted
+
+    template <typename Fn> unsigned reap(Fn&& fn, unsigned max = UINT32_MAX) // fn(const io_uring_cqe&) for up to max completions
+    {
+        unsigned head = *cq_head_;
+        unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        unsigned count = std::min(tail - head, max);
+        tail = head + count;
+        for (; head != tail; ++head) fn(cqes_[head & cq_mask_]);
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+        return count;
+    }
+
+    char* buffer(uint16_t id) const { return buffers_ + size_t(id) * buffer_size_; } // Provided buffer a completion picked
+    void recycle(uint16_t id); // Give a provided buffer back to the kernel
+
+    bool acceptMultishot(int fd, uint64_t tag, int flags); // One completion per accepted socket
+    bool recvMultishot(int fd, uint16_t group, uint64_t tag); // One completion per read, data in a provided buffer
+    bool pollMultishot(int fd, uint64_t tag); // One completion per POLLIN edge
+    bool sendmsg(int fd, const msghdr* msg, uint64_t tag); // Scatter-gather write, msg must stay valid until it completes
+    bool cancel(uint64_t target, uint64_t tag); // Cancel the request whose user_data is target (ends a multishot request)
+
+private:
+    int fd_ = -1; // io_uring instance
+    void* sq_ring_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    void* cq_ring_ = nullptr; // Same mapping as sq_ring_ with IORING_FEAT_SINGLE_MMAP
+    size_t cq_ring_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+
+    unsigned* sq_head_ = nullptr; // Kernel consumes from here
+    unsigned* sq_tail_ = nullptr; // Published by submit()
+    unsigned* sq_array_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned sq_entries_ = 0;
+    unsigned sqe_tail_ = 0; // Next entry handed out by sqe()
+    unsigned sqe_submitted_ = 0; // Entries the kernel took so far
+
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+
+    io_uring_buf_ring* buf_ring_ = nullptr; // Provided-buffer ring shared with the kernel
+    size_t buf_ring_size_ = 0;
+    char* buffers_ = nullptr; // count * size bytes the ring entries point into
+    unsigned buffer_count_ = 0;
+    unsigned buffer_size_ = 0;
+    uint16_t buf_tail_ = 0; // Entries published so far (wraps like the kernel's 16-bit tail)
+};
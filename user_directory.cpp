@@ -0,0 +1,44 @@
+#include "user_directory.h"
+#include <algorithm>
+#include <functional>
+
+UserDirectory::UserDirectory(size_t stripes) : stripes_(stripes == 0 ? 1 : stripes) {} // Constructor
+
+UserDirectory::Stripe& UserDirectory::stripeOf(std::string_view name)
+{
+    return stripes_[std::hash<std::string_view>()(name) % stripes_.size()];
+}
+
+void UserDirectory::add(std::string_view name, const DirectoryEntry& entry)
+{
+    Stripe& stripe = stripeOf(name);
+    std::unique_lock<std::shared_mutex> lock(stripe.mutex);
+    stripe.users[std::string(name)].push_back(entry);
+}
+
+void UserDirectory::remove(std::string_view name, uint32_t sessionId)
+{
+    Stripe& stripe = stripeOf(name);
+    std::unique_lock<std::shared_mutex> lock(stripe.mutex); // Waits for lookups still using the entry
+
+    auto it = stripe.users.find(std::string(name));
+    if (it == stripe.users.end()) return;
+
+    std::vector<DirectoryEntry>& entries = it->second;
+    auto entry = std::find_if(entries.begin(), entries.end(), [sessionId](const DirectoryEntry& e) { return e.sessionId == sessionId; });
+    if (entry == entries.end()) return;
+    *entry = entries.back();
+    entries.pop_back();
+    if (entries.empty()) stripe.users.erase(it);
+}
+
+size_t UserDirectory::size()
+{
+    size_t total = 0;
+    for (Stripe& stripe : stripes_)
+    {
+        std::shared_lock<std::shared_mutex> lock(stripe.mutex);
+        total += stripe.users.size();
+    }
+    return total;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct Connection;
+
+// Nickname -> connections, maintained by the handshake and by disconnects, so a direct
+// message finds its recipient with one hash lookup however many users are online. The map is
+// split into stripes by name hash, each behind a shared lock: lookups in different stripes
+// never contend and lookups in the same stripe only wait for a handshake or disconnect.
+// A nickname may be held by several connections (the same user logged in twice); a direct
+// message goes to all of them.
+
+struct DirectoryEntry
+{
+    Connection* conn; // Threaded mode: valid while listed (removal takes the stripe lock)
+    uint32_t sessionId; // Epoll mode: looked up again by the owning shard
+    int shard; // Epoll mode: shard owning the connection, -1 in threaded mode
+};
+
+class UserDirectory {
+public:
+    explicit UserDirectory(size_t stripes = 64); // Constructor
+
+    void add(std::string_view name, const DirectoryEntry& entry);
+    void remove(std::string_view name, uint32_t sessionId);
+    size_t size(); // Nicknames held by at least one connection
+
+    template <typename F>
+    size_t forEach(std::string_view name, F&& fn) // Calls fn(const DirectoryEntry&) under the stripe's shared lock
+    {
+        thread_local std::string key; // Nicknames run to 255 bytes: reuse one buffer instead of a string per lookup
+        key.assign(name.data(), name.size());
+        Stripe& stripe = stripeOf(name);
+        std::shared_lock<std::shared_mutex> lock(stripe.mutex);
+        auto it = stripe.users.find(key);
+        if (it == stripe.users.end()) return 0;
+        for (const DirectoryEntry& entry : it->second) fn(entry);
+        return it->second.size();
+    }
+
+private:
+    struct Stripe
+    {
+        std::shared_mutex mutex; // Shared for lookups, exclusive for add/remove
+        std::unordered_map<std::string, std::vector<DirectoryEntry>> users; // Usually one entry per name
+    };
+
+    Stripe& stripeOf(std::string_view name);
+
+    std::vector<Stripe> stripes_;
+};
@@ -0,0 +1,116 @@
+#include "worker_pool.h"
+#include <algorithm>
+
+WorkerPool::WorkerPool(size_t threads)
+{
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < threads; ++i) queues_.push_back(std::make_unique<Queue>());
+}
+
+WorkerPool::~WorkerPool()
+{
+    stop();
+}
+
+void WorkerPool::start()
+{
+    if (!threads_.empty()) return;
+    stopping_ = false;
+    for (size_t i = 0; i < queues_.size(); ++i)
+    {
+        threads_.emplace_back(&WorkerPool::workerLoop, this, i);
+    }
+}
+
+void WorkerPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stopping_ = true;
+    }
+    wake_cv_.notify_all();
+
+    for (std::thread& t : threads_) // Workers leave once every queue is empty
+    {
+        if (t.joinable()) t.join();
+    }
+    threads_.clear();
+}
+
+bool WorkerPool::submit(Task task, size_t hint)
+{
+    pending_.fetch_add(1); // seq_cst: a worker either sees the task coming or we see it sleeping / stopping
+    if (stopping_)
+    {
+        pending_.fetch_sub(1); // Workers may already have left
+        return false;
+    }
+
+    Queue& queue = *queues_[hint % queues_.size()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+
+    if (sleepers_.load() != 0)
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        wake_cv_.notify_one();
+    }
+    return true;
+}
+
+WorkerPoolStats WorkerPool::stats() const
+{
+    return {queues_.size(), executed_.load(std::memory_order_relaxed), stolen_.load(std::memory_order_relaxed), pending_.load()};
+}
+
+bool WorkerPool::take(size_t index, Task& task)
+{
+    {
+        Queue& own = *queues_[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty())
+        {
+            task = std::move(own.tasks.front());
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+
+    for (size_t i = 1; i < queues_.size(); ++i) // Steal, starting with the next worker
+    {
+        Queue& victim = *queues_[(index + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            stolen_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkerPool::workerLoop(size_t index)
+{
+    Task task;
+    while (true)
+    {
+        if (take(index, task))
+        {
+            pending_.fetch_sub(1);
+            task();
+            task = nullptr; // Release captures before sleeping
+            executed_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        if (stopping_ && pending_.load() == 0) break; // Drained
+        sleepers_.fetch_add(1);
+        wake_cv_.wait(lock, [this]() { return pending_.load() != 0 || stopping_.load(); });
+        sleepers_.fetch_sub(1);
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "slab_pool.h"
+
+// Fixed set of worker threads behind the threaded server. Every worker owns a task queue;
+// submit() puts a task on the queue picked by its hint (a socket keeps landing on the same
+// worker), and a worker that runs dry steals from the back of the others' queues before it
+// sleeps. The thread count never depends on the number of clients, and stop() runs every
+// task already submitted before joining the workers.
+
+using Task = std::function<void()>;
+
+struct WorkerPoolStats
+{
+    size_t threads; // Worker threads
+    uint64_t executed; // Tasks run
+    uint64_t stolen; // Tasks run by a worker other than the one they were queued on
+    size_t pending; // Tasks queued and not started yet
+};
+
+class WorkerPool {
+public:
+    explicit WorkerPool(size_t threads = 0); // Constructor, 0 means one worker per hardware thread
+    ~WorkerPool(); // Destructor, stops the workers
+
+    void start(); // Launch the workers
+    void stop(); // Run the queued tasks, then join the workers. submit() fails from here on
+
+    bool submit(Task task, size_t hint = 0); // Any thread. False once stop() was called
+    size_t size() const { return queues_.size(); }
+    WorkerPoolStats stats() const;
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task, SlabAllocator<Task>> tasks; // Owner pops the front, thieves take the back
+    };
+
+    void workerLoop(size_t index); // Own queue first, then steal, then sleep
+    bool take(size_t index, Task& task); // Next task for worker index, false if every queue is empty
+
+    std::vector<std::unique_ptr<Queue>> queues_; // One per worker
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> pending_{0}; // Tasks queued over all workers
+    std::atomic<size_t> sleepers_{0}; // Workers (about to be) waiting on wake_cv_
+    std::atomic<bool> stopping_{false};
+    std::atomic<uint64_t> executed_{0};
+    std::atomic<uint64_t> stolen_{0};
+    std::mutex wake_mutex_; // Only taken to sleep or to wake a sleeping worker
+    std::condition_variable wake_cv_;
+};